@@ -0,0 +1,204 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+#ifndef __LOCKFREE_ATOMIC16_H__
+#define __LOCKFREE_ATOMIC16_H__
+
+//////////////////////////////////////////////////////////////
+/* 16 byte atomics (DWCAS) that never leave the caller      */
+//////////////////////////////////////////////////////////////
+// std::atomic<T> of a 16 byte T is a call into libatomic with
+// GCC (-latomic), which may take a lock inside. lf_atomic16<T>
+// is the same interface on an inline lock cmpxchg16b (x86-64,
+// GCC / clang asm, MSVC _InterlockedCompareExchange128), so
+// every operation is one instruction and lock-free by
+// construction; a build that still calls libatomic for it
+// fails to link without -latomic (make dwcas-check).
+//
+// load() is single copy atomic: a plain vmovdqa when built for
+// AVX (atomic there, the libatomic choice), else a cmpxchg16b
+// that writes the line. load_split() reads the two halves
+// apart and may mix two values, fine only as the expected
+// value of a compare_exchange that validates it.
+//
+// Every constructor checks once that the cpu has cmpxchg16b
+// (lf_dwcas_check, CPUID + a test DWCAS) and aborts if not.
+// -DLF_DWCAS_LIBATOMIC (or any other target) falls back to
+// std::atomic<T>, for comparison (make ffbench-libatomic).
+//////////////////////////////////////////////////////////////
+#if !defined(LF_DWCAS_LIBATOMIC) && defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#define LF_DWCAS_INLINE 1
+#elif !defined(LF_DWCAS_LIBATOMIC) && (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define LF_DWCAS_INLINE 1
+#else
+#define LF_DWCAS_INLINE 0
+#endif
+
+#if (LF_DWCAS_INLINE)
+
+/* (dst) = (desired) if (dst) == (expected), else (expected) = (dst) */
+static inline bool lf_dwcas(volatile uint64_t * dst, uint64_t * expected, const uint64_t * desired)
+{
+#ifdef _MSC_VER
+	return _InterlockedCompareExchange128(
+		(volatile __int64 *)dst, (__int64)desired[1], (__int64)desired[0], (__int64 *)expected
+	) != 0;
+#else
+	bool ok;
+	__asm__ __volatile__(
+		"lock cmpxchg16b %1\n\t"
+		"sete %0"
+		: "=q"(ok), "+m"(dst[0]), "+m"(dst[1]), "+a"(expected[0]), "+d"(expected[1])
+		: "b"(desired[0]), "c"(desired[1])
+		: "cc", "memory"
+	);
+	return ok;
+#endif
+}
+
+#endif // LF_DWCAS_INLINE
+
+/* the cpu has cmpxchg16b (CPUID.01H:ECX.CX16) and it behaves, *
+ * always true for the std::atomic fallback                    */
+static inline bool lf_dwcas_check()
+{
+#if (LF_DWCAS_INLINE)
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 13)) == 0) { return false; }
+#else
+	unsigned a, b, c, d;
+	if (!__get_cpuid(1, &a, &b, &c, &d) || ((c & bit_CMPXCHG16B) == 0)) { return false; }
+#endif
+	alignas(16) volatile uint64_t word[2] = { 1, 2 };
+	uint64_t expected[2] = { 1, 3 };
+	uint64_t desired [2] = { 4, 5 };
+
+	/* a mismatch in the high half fails and reports the value */
+	if (lf_dwcas(word, expected, desired) || (expected[0] != 1) || (expected[1] != 2)) { return false; }
+	if (!lf_dwcas(word, expected, desired) || (word[0] != 4) || (word[1] != 5))       { return false; }
+#endif
+	return true;
+}
+
+/* once per process, by every lf_atomic16 constructor: the DWCAS *
+ * would fault (SIGILL) later on, stop here instead               */
+static inline void lf_dwcas_require()
+{
+	static const bool usable = lf_dwcas_check();
+	if (!usable) { abort(); }
+}
+
+template <typename T> class lf_atomic16
+{
+	static_assert(sizeof(T) == 16, "lf_atomic16<T>: T must be 16 bytes");
+	static_assert(std::is_trivially_copyable<T>::value, "lf_atomic16<T>: T must be trivially copyable");
+
+#if (LF_DWCAS_INLINE)
+	alignas(16) volatile uint64_t word[2];
+
+	static inline T get(const uint64_t * w) { T v; memcpy(&v, w, sizeof(T)); return v; };
+	static inline void put(uint64_t * w, const T & v) { memcpy(w, &v, sizeof(T)); };
+
+public:
+	static constexpr bool is_always_lock_free = true;
+
+	lf_atomic16() { lf_dwcas_require(); word[0] = 0; word[1] = 0; };
+	lf_atomic16(T v) { lf_dwcas_require(); uint64_t w[2]; put(w, v); word[0] = w[0]; word[1] = w[1]; };
+
+	lf_atomic16(const lf_atomic16 &) = delete;
+	lf_atomic16 & operator=(const lf_atomic16 &) = delete;
+
+	inline bool is_lock_free() const { return true; };
+
+	inline T load(std::memory_order = std::memory_order_seq_cst) const {
+		alignas(16) uint64_t w[2] = { 0, 0 };
+#ifdef __AVX__
+		/* an aligned 16 byte vmovdqa is single copy atomic on AVX cpus, as in libatomic */
+		std::atomic_signal_fence(std::memory_order_seq_cst);
+		_mm_store_si128((__m128i *)w, _mm_load_si128((const __m128i *)const_cast<uint64_t *>(word)));
+		std::atomic_signal_fence(std::memory_order_acquire);
+#else
+		lf_dwcas(const_cast<volatile uint64_t *>(word), w, w);
+#endif
+		return get(w);
+	};
+
+	inline T load_split(std::memory_order = std::memory_order_seq_cst) const {
+		uint64_t w[2] = { word[0], word[1] };
+		std::atomic_signal_fence(std::memory_order_acquire);
+		return get(w);
+	};
+
+	inline void store(T v, std::memory_order = std::memory_order_seq_cst) {
+		uint64_t w[2] = { word[0], word[1] };
+		uint64_t n[2];
+		put(n, v);
+		while (!lf_dwcas(word, w, n)) { ; }
+	};
+
+	/* always a full barrier, memory orders are accepted for std::atomic compatibility */
+	inline bool compare_exchange_strong(
+		T & expected, T desired,
+		std::memory_order = std::memory_order_seq_cst, std::memory_order = std::memory_order_seq_cst
+	) {
+		uint64_t e[2], n[2];
+		put(e, expected);
+		put(n, desired);
+		if (lf_dwcas(word, e, n)) { return true; }
+		expected = get(e);
+		return false;
+	};
+
+	inline bool compare_exchange_weak(
+		T & expected, T desired,
+		std::memory_order = std::memory_order_seq_cst, std::memory_order = std::memory_order_seq_cst
+	) {
+		return compare_exchange_strong(expected, desired);
+	};
+#else
+	std::atomic<T> value;
+
+public:
+#ifdef __cpp_lib_atomic_is_always_lock_free
+	static constexpr bool is_always_lock_free = std::atomic<T>::is_always_lock_free;
+#endif
+
+	lf_atomic16() { ; };
+	lf_atomic16(T v) : value(v) { ; };
+
+	lf_atomic16(const lf_atomic16 &) = delete;
+	lf_atomic16 & operator=(const lf_atomic16 &) = delete;
+
+	inline bool is_lock_free() const { return value.is_lock_free(); };
+
+	inline T load      (std::memory_order o = std::memory_order_seq_cst) const { return value.load(o); };
+	inline T load_split(std::memory_order o = std::memory_order_seq_cst) const { return value.load(o); };
+
+	inline void store(T v, std::memory_order o = std::memory_order_seq_cst) { value.store(v, o); };
+
+	inline bool compare_exchange_strong(
+		T & expected, T desired,
+		std::memory_order s = std::memory_order_seq_cst, std::memory_order f = std::memory_order_seq_cst
+	) {
+		return value.compare_exchange_strong(expected, desired, s, f);
+	};
+
+	inline bool compare_exchange_weak(
+		T & expected, T desired,
+		std::memory_order s = std::memory_order_seq_cst, std::memory_order f = std::memory_order_seq_cst
+	) {
+		return value.compare_exchange_weak(expected, desired, s, f);
+	};
+#endif
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
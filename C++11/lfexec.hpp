@@ -0,0 +1,228 @@
+#include <stdint.h>
+#include <climits>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+#include "rbq.hpp"
+#include "wsdeque.hpp"
+#include "lfthread.hpp"
+
+#ifndef __LOCKFREE_EXECUTOR_H__
+#define __LOCKFREE_EXECUTOR_H__
+
+/* idle rounds of a worker (pause, then yield) before it parks */
+#ifndef LFEXEC_SPINS
+#define LFEXEC_SPINS 256
+#endif
+
+//////////////////////////////////////////////////////////////
+/* tasks                                                    */
+//////////////////////////////////////////////////////////////
+// A task is owned by its submitter until run() starts, the
+// executor never copies or frees it: run() may delete this
+// (lftask_fn_t does), or the task may live in an array that
+// outlasts the work.
+//////////////////////////////////////////////////////////////
+struct lftask_t
+{
+	virtual ~lftask_t() { ; };
+	virtual void run() = 0;
+};
+
+/* a callable on the heap, deletes itself once run */
+template <typename F> struct lftask_fn_t : lftask_t
+{
+	F fn;
+
+	template <typename G> explicit lftask_fn_t(G && g) : fn(std::forward<G>(g)) { ; };
+
+	void run() override { fn(); delete this; };
+};
+
+//////////////////////////////////////////////////////////////
+/* work-stealing thread pool                                */
+//////////////////////////////////////////////////////////////
+// Every worker owns a wsdeque: a task submitted from a worker
+// goes on its own deque (newest first, the cache is warm),
+// a task submitted from any other thread goes on the shared
+// rbqueue injection queue. An idle worker takes, in order:
+// its own deque, the injection queue, the top (oldest end)
+// of the other workers' deques from a random victim on.
+//
+// A worker that finds nothing spins LFEXEC_SPINS rounds, then
+// parks on a futex (an event count): it counts itself in
+// (sleepers), looks at every queue once more and sleeps only
+// if (wakeups) did not move meanwhile. submit() publishes the
+// task, fences and wakes one worker only if (sleepers) is not
+// zero, so a busy pool never makes a system call. Without
+// futexes (not linux) a parked worker yields instead.
+//
+// The destructor lets the workers drain every queue (tasks
+// may still spawn tasks) and joins them; submitting from
+// outside once it started is an error. A task must not throw.
+//////////////////////////////////////////////////////////////
+class lfexecutor_t
+{
+	struct worker
+	{
+		wsdeque<lftask_t *> local;
+		lfexecutor_t *      pool;
+		uint32_t            seed;  /* victim choice */
+		std::thread         thread;
+
+		worker(lfexecutor_t * p, int order, int flags, uint32_t s) : local(order, flags), pool(p), seed(s) { ; };
+	};
+
+protected:
+	alignas(64) std::atomic<uint32_t> wakeups;   /* futex word, moves on every wake */
+	alignas(64) std::atomic<uint32_t> sleepers;  /* workers parked or about to */
+	alignas(64) std::atomic<bool>     stopping;
+
+	rbqueue<lftask_t *>   inject;
+	std::vector<worker *> workers;
+
+	/* the worker the calling thread is, nullptr outside of any pool */
+	static inline worker *& self() {
+		thread_local worker * w = nullptr;
+		return w;
+	};
+
+	inline bool haswork()
+	{
+		if (!inject.isempty()) { return true; }
+		for (worker * w : workers) {
+			if (!w->local.isempty()) { return true; }
+		}
+		return false;
+	};
+
+	/* own deque, injection queue, then steal */
+	inline lftask_t * find(worker * w)
+	{
+		lftask_t * task;
+		if (w->local.pop(task))    { return task; }
+		if (inject.try_pop(task))  { return task; }
+
+		size_t n = workers.size();
+		w->seed ^= w->seed << 13;
+		w->seed ^= w->seed >> 17;
+		w->seed ^= w->seed << 5;
+		for (size_t i = 0, v = w->seed % n; i < n; ++i, v = (v + 1 == n) ? 0 : v + 1) {
+			if ((workers[v] != w) && workers[v]->local.steal(task)) { return task; }
+		}
+		return nullptr;
+	};
+
+	/* wake (count) parked workers, if any */
+	inline void wake(int count)
+	{
+		/* pairs with the fence in park(): either we see the sleeper, *
+		 * or the sleeper sees the task we just published.            */
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleepers.load(std::memory_order_relaxed) == 0) { return; }
+
+		wakeups.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+		syscall(SYS_futex, (uint32_t *)(&wakeups), FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#else
+		(void)count;
+#endif
+	};
+
+	inline void park()
+	{
+		uint32_t seen = wakeups.load(std::memory_order_acquire);
+
+		sleepers.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!haswork() && !stopping.load(std::memory_order_acquire)) {
+#ifdef __linux__
+			syscall(SYS_futex, (uint32_t *)(&wakeups), FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+#else
+			(void)seen;
+			sched_yield();
+#endif
+		}
+		sleepers.fetch_sub(1, std::memory_order_relaxed);
+	};
+
+	inline void loop(worker * w)
+	{
+		uint32_t idle = 0;
+
+		self() = w;
+		while (1) {
+			lftask_t * task = find(w);
+			if (task != nullptr) {
+				idle = 0;
+				task->run();
+				continue;
+			}
+
+			if (stopping.load(std::memory_order_acquire) && !haswork()) { break; }
+			if (++idle < LFEXEC_SPINS) {
+				if (idle < LFEXEC_SPINS / 2) { cpu_relax(); } else { sched_yield(); }
+				continue;
+			}
+			park();
+			idle = 0;
+		}
+		self() = nullptr;
+	};
+
+public:
+	/* (threads) workers, 0 for one per cpu; (1 << order) slots in the  *
+	 * injection queue and, to begin with, in every deque; LFMEM_* flags */
+	lfexecutor_t(int threads = 0, int order = 12, int flags = 0) : wakeups(0), sleepers(0), stopping(false), inject(order, flags)
+	{
+		if (threads <= 0) { threads = (int)std::thread::hardware_concurrency(); }
+		if (threads <= 0) { threads = 1; }
+
+		/* every deque exists before any worker may steal from it */
+		for (int i = 0; i < threads; ++i) {
+			workers.push_back(new worker(this, order, flags, (uint32_t)(i + 1) * 0x9E3779B9u));
+		}
+		for (worker * w : workers) {
+			w->thread = std::thread(&lfexecutor_t::loop, this, w);
+		}
+	};
+
+	virtual ~lfexecutor_t() {
+		stopping.store(true, std::memory_order_release);
+		wake(INT_MAX);
+		for (worker * w : workers) { w->thread.join(); }
+		for (worker * w : workers) { delete w; }
+	};
+
+	inline size_t getsize() { return workers.size(); };
+
+	/* submit @ any thread; a worker of this pool keeps the task, others inject it */
+	inline void submit(lftask_t * task)
+	{
+		worker * w = self();
+		if ((w != nullptr) && (w->pool == this)) {
+			w->local.push(task);
+		}
+		else {
+			/* injection queue full: the workers are draining it */
+			while (!inject.try_push(task)) { sched_yield(); }
+		}
+		wake(1);
+	};
+
+	/* submit a callable, wrapped in a lftask_fn_t on the heap */
+	template <
+		typename F,
+		typename = typename std::enable_if<!std::is_convertible<F, lftask_t *>::value>::type
+	> inline void submit(F && fn)
+	{
+		submit(static_cast<lftask_t *>(new lftask_fn_t<typename std::decay<F>::type>(std::forward<F>(fn))));
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
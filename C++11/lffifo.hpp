@@ -1,5 +1,12 @@
 #include <stdint.h>
 #include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "lfatomic.hpp"
+#include "lfmem.hpp"
+#include "lfthread.hpp"
 
 #ifndef __LOCKFREE_STRUCT_H__
 #define __LOCKFREE_STRUCT_H__
@@ -12,8 +19,11 @@ template <typename T> struct lf_node_t
     lf_node_t * node;
     uint64_t    aba_;
 
-    T           valu;
+    /* raw storage, the object lives here only while the node is in use */
+    alignas(T) unsigned char valu[sizeof(T)];
     uint64_t    padd;
+
+    inline T * value() { return reinterpret_cast<T *>(valu); };
 };
 
 struct lf_pointer_t
@@ -21,12 +31,15 @@ struct lf_pointer_t
     lf_pointer_t * node;
     uint64_t       aba_;
 };
+
+/* tagged head / link, inline cmpxchg16b (lfatomic.hpp) */
+typedef lf_atomic16<lf_pointer_t> lf_atomic_pointer_t;
 //////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////
 /* common functions used by fifo/stack for freelist         */
 //////////////////////////////////////////////////////////////
-static inline void lfstack_init_internal(std::atomic<lf_pointer_t> * head) {
+static inline void lfstack_init_internal(lf_atomic_pointer_t * head) {
     lf_pointer_t pt;
     pt.node = nullptr;
     pt.aba_ = 0;
@@ -35,14 +48,14 @@ static inline void lfstack_init_internal(std::atomic<lf_pointer_t> * head) {
 }
 
 static inline bool lfstack_push_internal(
-    std::atomic<lf_pointer_t> * head, lf_pointer_t * pt
+    lf_atomic_pointer_t * head, lf_pointer_t * pt
 )
 {
     lf_pointer_t orig;
     lf_pointer_t next;
 
     do {
-        orig = head->load(std::memory_order_acquire);
+        orig = head->load_split(std::memory_order_acquire);
 
         next.aba_ = orig.aba_ + 1;
         next.node = pt;
@@ -56,7 +69,7 @@ static inline bool lfstack_push_internal(
 }
 
 static inline lf_pointer_t* lfstack_pop_internal(
-    std::atomic<lf_pointer_t>* head
+    lf_atomic_pointer_t * head
 )
 {
     lf_pointer_t orig;
@@ -65,7 +78,7 @@ static inline lf_pointer_t* lfstack_pop_internal(
     lf_pointer_t * node;
 
     do {
-        orig = head->load(std::memory_order_acquire);
+        orig = head->load_split(std::memory_order_acquire);
 
         node = orig.node;
         if (node == NULL) {
@@ -81,25 +94,251 @@ static inline lf_pointer_t* lfstack_pop_internal(
     return (node);
 }
 
+/* one attempt of push, false if another thread moved (head) */
+static inline bool lfstack_trypush_internal(
+    lf_atomic_pointer_t * head, lf_pointer_t * pt
+)
+{
+    lf_pointer_t orig = head->load_split(std::memory_order_acquire);
+    lf_pointer_t next;
+
+    next.aba_ = orig.aba_ + 1;
+    next.node = pt;
+
+    /* make a link */
+    pt->node = orig.node;
+    pt->aba_ = next.aba_;
+
+    return head->compare_exchange_strong(orig, next);
+}
+
+/* one attempt of pop, false if another thread moved (head), *
+ * else (*pnode) is the node taken or NULL when empty.       */
+static inline bool lfstack_trypop_internal(
+    lf_atomic_pointer_t * head, lf_pointer_t ** pnode
+)
+{
+    lf_pointer_t orig = head->load_split(std::memory_order_acquire);
+    lf_pointer_t next;
+
+    *pnode = orig.node;
+    if (orig.node == NULL) {
+        return true;
+    }
+
+    next.aba_ = orig.aba_ + 1;
+    next.node = orig.node->node;
+
+    if (head->compare_exchange_strong(orig, next)) {
+        return true;
+    }
+
+    *pnode = NULL;
+    return false;
+}
+
+//////////////////////////////////////////////////////////////
+/* elimination backoff (Hendler, Shavit & Yerushalmi)       */
+//////////////////////////////////////////////////////////////
+// A push or pop that loses the CAS on the stack head backs off
+// into a random slot of an array instead of retrying at once.
+// A pusher posts its node there and waits LFSTACK_ELIM_SPINS
+// rounds; a popper that finds a posted node takes it, and the
+// pair is done without touching the head at all (a push
+// immediately followed by a pop is a no-op on the stack).
+//
+// Each thread keeps its own range of slots in use: it doubles
+// when the chosen slot was busy (many threads backing off)
+// and halves when nobody showed up (few threads), so the
+// meeting rate stays high from 2 to LF_MAXTHREADS threads.
+// Every slot change bumps the tag, so a pusher can always
+// tell whether its node is still there when it withdraws.
+//////////////////////////////////////////////////////////////
+#ifndef LFSTACK_ELIM_SLOTS
+#define LFSTACK_ELIM_SLOTS 16
+#endif
+
+#ifndef LFSTACK_ELIM_SPINS
+#define LFSTACK_ELIM_SPINS 128
+#endif
+
+class lfstack_elim_t {
+protected:
+    struct alignas(64) slot_t
+    {
+        lf_atomic_pointer_t cell;  /* posted node or NULL, tagged */
+    };
+
+    struct alignas(64) local_t
+    {
+        uint32_t range;  /* slots in use, [1, LFSTACK_ELIM_SLOTS] */
+        uint32_t seed;   /* xorshift state */
+    };
+
+    slot_t  slots[LFSTACK_ELIM_SLOTS];
+    local_t local[LF_MAXTHREADS];  /* owner thread only */
+
+    inline lf_atomic_pointer_t & pick(local_t & me) {
+        me.seed ^= me.seed << 13;
+        me.seed ^= me.seed >> 17;
+        me.seed ^= me.seed << 5;
+        return slots[me.seed % me.range].cell;
+    };
+
+    inline void widen (local_t & me) { if (me.range < LFSTACK_ELIM_SLOTS) { me.range <<= 1; } };
+    inline void narrow(local_t & me) { if (me.range > 1) { me.range >>= 1; } };
+
+public:
+    lfstack_elim_t() {
+        for (int i = 0; i < LFSTACK_ELIM_SLOTS; ++i) {
+            lfstack_init_internal(&slots[i].cell);
+        }
+        for (int t = 0; t < LF_MAXTHREADS; ++t) {
+            local[t].range = 1;
+            local[t].seed  = (uint32_t)(t + 1) * 0x9E3779B9u;
+        }
+    };
+
+    /* offer (pt) to a popper, true if one took it */
+    inline bool give(lf_pointer_t * pt)
+    {
+        local_t & me = local[lf_thread_index()];
+        lf_atomic_pointer_t & cell = pick(me);
+
+        lf_pointer_t orig = cell.load_split(std::memory_order_acquire);
+        if (orig.node != NULL) { widen(me); return false; }
+
+        lf_pointer_t mine;
+        mine.node = pt;
+        mine.aba_ = orig.aba_ + 1;
+        if (!cell.compare_exchange_strong(orig, mine)) { widen(me); return false; }
+
+        /* only a popper changes a posted slot */
+        for (int i = 0; i < LFSTACK_ELIM_SPINS; ++i) {
+            if (cell.load_split(std::memory_order_acquire).aba_ != mine.aba_) { return true; }
+            cpu_relax();
+        }
+
+        lf_pointer_t none;
+        none.node = NULL;
+        none.aba_ = mine.aba_ + 1;
+        if (cell.compare_exchange_strong(mine, none)) { narrow(me); return false; }
+
+        /* taken while withdrawing */
+        return true;
+    };
+
+    /* take a node offered by a pusher, NULL if none */
+    inline lf_pointer_t * take()
+    {
+        local_t & me = local[lf_thread_index()];
+        lf_atomic_pointer_t & cell = pick(me);
+
+        lf_pointer_t orig = cell.load_split(std::memory_order_acquire);
+        if (orig.node == NULL) { narrow(me); return NULL; }
+
+        lf_pointer_t none;
+        none.node = NULL;
+        none.aba_ = orig.aba_ + 1;
+        if (cell.compare_exchange_strong(orig, none)) { return orig.node; }
+
+        widen(me);
+        return NULL;
+    };
+
+    /* lfstack_push_internal, backing off into the array */
+    inline void push(lf_atomic_pointer_t * head, lf_pointer_t * pt)
+    {
+        while (!lfstack_trypush_internal(head, pt)) {
+            if (give(pt)) { return; }
+        }
+    };
+
+    /* lfstack_pop_internal, backing off into the array */
+    inline lf_pointer_t * pop(lf_atomic_pointer_t * head)
+    {
+        lf_pointer_t * node;
+        while (!lfstack_trypop_internal(head, &node)) {
+            if ((node = take()) != NULL) { return node; }
+        }
+        return node;
+    };
+};
+
 //////////////////////////////////////////////////////////////
 /* lock-free stack                                          */
 //////////////////////////////////////////////////////////////
+// With (maxorder > order) the freelist grows when it runs dry:
+// one more chunk of (1 << order) nodes is allocated and linked
+// onto (chunks) with a DWCAS, up to (1 << maxorder) nodes in
+// all. (chunks).node is the newest chunk, (chunks).aba_ the
+// nodes grown so far; the first node of a chunk links to the
+// previous one. Chunks are only freed with the stack.
+//////////////////////////////////////////////////////////////
 template <typename T> class lfstack_t {
 protected:
-    alignas(64) std::atomic<lf_pointer_t> worklist;
-    alignas(64) std::atomic<lf_pointer_t> freelist;
+    alignas(64) lf_atomic_pointer_t       worklist;
+    alignas(64) lf_atomic_pointer_t       freelist;
     alignas(64) std::atomic<uint64_t>     size;
+    alignas(64) lf_atomic_pointer_t       chunks;
+
+    lfstack_elim_t          workelim;  /* backoff of (worklist) */
+    lfstack_elim_t          freeelim;  /* backoff of (freelist) */
 
     uint64_t                capacity;
+    uint64_t                maxcapacity;  /* ceiling of (capacity) + grown nodes */
     lf_node_t<T> *          nodes;
+    int                     mflags;  /* LFMEM_* flags of (nodes) and chunks */
+
+    inline size_t chunkbytes() { return sizeof(lf_node_t<T>) * (capacity + 1); };
+
+    /* freelist ran dry: link one more chunk, keep its first node */
+    lf_node_t<T> * grow()
+    {
+        lf_node_t<T> * chunk = nullptr;
+        lf_pointer_t   orig  = chunks.load(std::memory_order_acquire);
+        lf_pointer_t   next;
+
+        while (1) {
+            /* another thread may have grown the freelist meanwhile */
+            lf_node_t<T> * node = (lf_node_t<T> *)freeelim.pop(&freelist);
+            if ((node != nullptr) || (capacity + orig.aba_ + capacity > maxcapacity)) {
+                if (chunk) { lfmem_free(chunk, chunkbytes(), mflags); }
+                return node;
+            }
+
+            if (chunk == nullptr) {
+                chunk = static_cast<lf_node_t<T> *>(lfmem_alloc(chunkbytes(), mflags));
+                if (chunk == nullptr) { return nullptr; }
+            }
+
+            chunk->node = (lf_node_t<T> *)(orig.node);
+            next.node   = (lf_pointer_t *)(chunk);
+            next.aba_   = orig.aba_ + capacity;
+            if (chunks.compare_exchange_weak(orig, next)) { break; }
+        }
+
+        /* hand out the rest */
+        for (uint64_t i = 2; i <= capacity; ++i) {
+            lfstack_push_internal(&freelist, (lf_pointer_t *)(&chunk[i]));
+        }
+        return &chunk[1];
+    }
 
 public:
-    lfstack_t(int order) : worklist(lf_pointer_t()), freelist(lf_pointer_t())
+    /* (flags): LFMEM_HUGEPAGE / LFMEM_POPULATE / LFMEM_LOCK backing */
+    lfstack_t(int order, int flags = 0) : lfstack_t(order, order, flags) { ; }
+
+    /* (1 << order) nodes, growing by (1 << order) up to (1 << maxorder) */
+    lfstack_t(int order, int maxorder, int flags)
+        : worklist(lf_pointer_t()), freelist(lf_pointer_t()), chunks(lf_pointer_t())
     {
         /* allocate memory */
-        capacity = (1ULL << order);
-        nodes    = new lf_node_t<T> [capacity];
-        if (nodes == nullptr) { return; };
+        capacity    = (1ULL << order);
+        maxcapacity = (maxorder > order) ? (1ULL << maxorder) : capacity;
+        mflags      = flags;
+        nodes       = static_cast<lf_node_t<T> *>(lfmem_alloc(sizeof(lf_node_t<T>) * capacity, flags));
+        if (nodes == nullptr) { throw std::bad_alloc(); };
 
         /* initialize freelist */
         for (uint64_t i = 0; i < capacity; ++i){
@@ -110,26 +349,56 @@ public:
     }
 
     ~lfstack_t(){
-        if (nodes){delete []nodes;}
+        /* destroy objects still in stack (no concurrent access here) */
+        if (!std::is_trivially_destructible<T>::value) {
+            lf_node_t<T> * node;
+            while ((node = (lf_node_t<T> *)lfstack_pop_internal(&worklist)) != NULL) {
+                node->value()->~T();
+            }
+        }
+        if (nodes){lfmem_free(nodes, sizeof(lf_node_t<T>) * capacity, mflags);}
+
+        lf_node_t<T> * chunk = (lf_node_t<T> *)(chunks.load().node);
+        while (chunk != nullptr) {
+            lf_node_t<T> * prev = chunk->node;
+            lfmem_free(chunk, chunkbytes(), mflags);
+            chunk = prev;
+        }
     }
 
     inline size_t getsize(){return (size.load(std::memory_order_acquire));            };
     inline bool   isempty(){return (size.load(std::memory_order_acquire) == 0);       };
-    inline bool    isfull(){return (size.load(std::memory_order_acquire) == capacity);};
+    inline bool    isfull(){return (size.load(std::memory_order_acquire) == maxcapacity);};
+
+    /* move the nodes to NUMA (node), only for nodes mapped with (flags != 0) */
+    inline bool bind(int node) {
+        if ((mflags == 0) || !lfmem_bind(nodes, sizeof(lf_node_t<T>) * capacity, node)) { return false; }
+
+        bool done = true;
+        for (lf_node_t<T> * c = (lf_node_t<T> *)(chunks.load().node); c != nullptr; c = c->node) {
+            done = lfmem_bind(c, chunkbytes(), node) && done;
+        }
+        return done;
+    };
 
-    bool push(const T & object)
+    bool push(const T &  object) { return emplace(object);            };
+    bool push(      T && object) { return emplace(std::move(object)); };
+
+    /* construct the object in place */
+    template <typename... Args> bool emplace(Args &&... args)
     {
         //////////////////////////////////////
         // allocate a new node              //
         //////////////////////////////////////
-        lf_node_t<T> * node = (lf_node_t<T> *)lfstack_pop_internal(&freelist);
+        lf_node_t<T> * node = (lf_node_t<T> *)freeelim.pop(&freelist);
+        if ((node == NULL) && (maxcapacity > capacity)){node = grow();}
         if (node == NULL){return false;}
 
-        /* write (node) with release (using move here) */
-        node->valu = object;
+        /* write (node) with release */
+        new (node->value()) T(std::forward<Args>(args)...);
         //////////////////////////////////////
 
-        lfstack_push_internal(
+        workelim.push(
             &worklist,
             (lf_pointer_t*)(node)
         );
@@ -142,14 +411,15 @@ public:
 
     bool pop(T & object)
     {
-        lf_node_t<T> * node = (lf_node_t<T> *)lfstack_pop_internal(&worklist);
+        lf_node_t<T> * node = (lf_node_t<T> *)workelim.pop(&worklist);
         if (node == NULL){return false;}
 
-        /* load (node) with acquire */
-        object = node->valu;
+        /* load (node) with acquire, move out & destroy */
+        object = std::move(*node->value());
+        node->value()->~T();
 
         /* free the node */
-        lfstack_push_internal(
+        freeelim.push(
             &freelist,
             (lf_pointer_t*)(node)
         );
@@ -161,7 +431,273 @@ public:
     }
 
     T pop(){
-        T object(0); pop(object); return object;
+        T object = T(); pop(object); return object;
+    };
+};
+//////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+/* lock-free queue (Michael & Scott)                        */
+//////////////////////////////////////////////////////////////
+// Free nodes are cached per thread (lf_thread_index) in a
+// magazine of LFFIFO_MAGAZINE nodes; the shared freelist only
+// sees whole batches of LFFIFO_MAGAZINE / 2 nodes, one DWCAS
+// per batch instead of one per node and message.
+//
+// A push that finds no free node raises (starving), and the
+// next thread that frees a node, or finds the queue empty,
+// gives back its whole magazine right away. Nodes cached by
+// a thread that stopped using the queue stay in its magazine,
+// so push can still fail before (1 << order) - 1 objects are
+// queued.
+//////////////////////////////////////////////////////////////
+#ifndef LFFIFO_MAGAZINE
+#define LFFIFO_MAGAZINE 16
+#endif
+
+template <typename T> struct lffifo_node_t
+{
+    lf_pointer_t              link;   /* freelist link, first member */
+    lf_atomic_pointer_t       next;   /* queue link, tag bumped on every reuse */
+    lffifo_node_t *           chain;  /* next node of a freelist batch */
+    std::atomic<uint32_t>     done;   /* value taken + node unlinked, 2 = free */
+
+    /* raw storage, the object lives here only while the node is queued */
+    alignas(T) unsigned char valu[sizeof(T)];
+
+    inline T * value() { return reinterpret_cast<T *>(valu); };
+};
+
+template <typename T> class lffifo_t {
+    typedef lffifo_node_t<T> node_t;
+
+    struct alignas(64) magazine
+    {
+        node_t * nodes[LFFIFO_MAGAZINE + 1];  /* + the node that came with a flush */
+        uint32_t count;
+    };
+
+protected:
+    alignas(64) lf_atomic_pointer_t       head;
+    alignas(64) lf_atomic_pointer_t       tail;
+    alignas(64) lf_atomic_pointer_t       freelist;  /* batches of free nodes */
+    alignas(64) std::atomic<uint32_t>     starving;  /* freelist found empty */
+
+    uint64_t                capacity;
+    node_t *                nodes;
+    magazine *              mags;
+    int                     mflags;  /* LFMEM_* flags of (nodes) */
+
+    static inline node_t * tonode(lf_pointer_t * p) { return reinterpret_cast<node_t *>(p); };
+    static inline lf_pointer_t * toptr(node_t * n) { return reinterpret_cast<lf_pointer_t *>(n); };
+
+    /* give a batch of nodes linked by (chain) to the freelist */
+    inline void putbatch(node_t * first) {
+        lfstack_push_internal(&freelist, &(first->link));
+    };
+
+    inline node_t * getnode()
+    {
+        magazine & mag = mags[lf_thread_index()];
+        if (mag.count == 0) {
+            node_t * batch = reinterpret_cast<node_t *>(lfstack_pop_internal(&freelist));
+            for (; batch != nullptr; batch = batch->chain) { mag.nodes[mag.count++] = batch; }
+            if (mag.count == 0) {
+                starving.store(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        return mag.nodes[--mag.count];
+    };
+
+    inline void putnode(node_t * node)
+    {
+        magazine & mag = mags[lf_thread_index()];
+        if (starving.load(std::memory_order_relaxed)) {
+            flush(mag, node);
+            return;
+        }
+        if (mag.count >= LFFIFO_MAGAZINE) {
+            /* full: hand the upper half over as one batch */
+            node_t * first = nullptr;
+            for (int i = 0; i < LFFIFO_MAGAZINE / 2; ++i) {
+                node_t * n = mag.nodes[--mag.count];
+                n->chain = first; first = n;
+            }
+            putbatch(first);
+        }
+        mag.nodes[mag.count++] = node;
+    };
+
+    /* a producer ran dry: give back the whole magazine (and (first)) at once */
+    inline void flush(magazine & mag, node_t * first = nullptr)
+    {
+        starving.store(0, std::memory_order_relaxed);
+        if (first != nullptr) { first->chain = nullptr; }
+        else if (mag.count == 0) { return; }
+
+        while (mag.count > 0) {
+            node_t * n = mag.nodes[--mag.count];
+            n->chain = first; first = n;
+        }
+        putbatch(first);
+    };
+
+    /* the taker of the value and the unlinker both release a node */
+    inline void release(node_t * node) {
+        if (node->done.fetch_add(1, std::memory_order_acq_rel) == 1) { putnode(node); }
+    };
+
+public:
+    /* (1 << order) nodes, one of them is the dummy; LFMEM_* (flags) backing */
+    lffifo_t(int order, int flags = 0)
+    {
+        /* allocate memory */
+        capacity = (1ULL << order);
+        mflags   = flags;
+        nodes    = static_cast<node_t *>(lfmem_alloc(sizeof(node_t) * capacity, flags));
+        if (nodes == nullptr) { throw std::bad_alloc(); };
+        mags     = new magazine[LF_MAXTHREADS];
+        for (int i = 0; i < LF_MAXTHREADS; ++i) { mags[i].count = 0; }
+
+        for (uint64_t i = 0; i < capacity; ++i) {
+            new (nodes + i) node_t();
+            nodes[i].next.store(lf_pointer_t());
+        }
+
+        /* initialize freelist, in batches */
+        lfstack_init_internal(&freelist);
+        starving.store(0);
+        for (uint64_t i = 1; i < capacity; i += LFFIFO_MAGAZINE / 2) {
+            node_t * first = nullptr;
+            for (uint64_t j = i; (j < i + LFFIFO_MAGAZINE / 2) && (j < capacity); ++j) {
+                nodes[j].chain = first; first = nodes + j;
+            }
+            putbatch(first);
+        }
+
+        /* node 0 is the dummy, it has no value to take */
+        nodes[0].done.store(1);
+        lf_pointer_t pt;
+        pt.node = toptr(nodes);
+        pt.aba_ = 0;
+        head.store(pt);
+        tail.store(pt);
+    }
+
+    ~lffifo_t(){
+        /* destroy objects still in queue (no concurrent access here) */
+        if (!std::is_trivially_destructible<T>::value) {
+            node_t * node = tonode(head.load().node);
+            while ((node = tonode(node->next.load().node)) != nullptr) {
+                node->value()->~T();
+            }
+        }
+        delete[] mags;
+        if (nodes){lfmem_free(nodes, sizeof(node_t) * capacity, mflags);}
+    }
+
+    inline size_t getsize(){return capacity - 1;};
+
+    inline bool isempty() {
+        lf_pointer_t h = head.load(std::memory_order_acquire);
+        return (h.node == tail.load(std::memory_order_acquire).node) &&
+               (tonode(h.node)->next.load(std::memory_order_acquire).node == nullptr);
+    };
+
+    /* move the nodes to NUMA (node), only for nodes mapped with (flags != 0) */
+    inline bool bind(int node) {
+        return (mflags != 0) && lfmem_bind(nodes, sizeof(node_t) * capacity, node);
+    };
+
+    bool push(const T &  object) { return emplace(object);            };
+    bool push(      T && object) { return emplace(std::move(object)); };
+
+    /* construct the object in place */
+    template <typename... Args> bool emplace(Args &&... args)
+    {
+        node_t * node = getnode();
+        if (node == nullptr){return false;}
+
+        /* a fresh tag: a slow thread still holding this node from its last use fails its CAS */
+        lf_pointer_t link = node->next.load(std::memory_order_relaxed);
+        link.node = nullptr;
+        link.aba_ = link.aba_ + 1;
+        node->next.store(link, std::memory_order_relaxed);
+        node->done.store(0, std::memory_order_relaxed);
+        new (node->value()) T(std::forward<Args>(args)...);
+
+        lf_pointer_t last, next, newp;
+        while (1)
+        {
+            last = tail.load(std::memory_order_acquire);
+            next = tonode(last.node)->next.load(std::memory_order_acquire);
+
+            lf_pointer_t again = tail.load(std::memory_order_acquire);
+            if ((last.node != again.node) || (last.aba_ != again.aba_)) { continue; }
+
+            if (next.node == nullptr) {
+                newp.node = toptr(node);
+                newp.aba_ = next.aba_ + 1;
+                if (tonode(last.node)->next.compare_exchange_weak(next, newp)) {
+                    break;  // Enqueue done!
+                }
+            } else {
+                /* tail is lagging, help it */
+                newp.node = next.node;
+                newp.aba_ = last.aba_ + 1;
+                tail.compare_exchange_weak(last, newp);
+            }
+        }
+
+        newp.node = toptr(node);
+        newp.aba_ = last.aba_ + 1;
+        tail.compare_exchange_strong(last, newp);
+
+        return (true);
+    }
+
+    bool pop(T & object)
+    {
+        lf_pointer_t first, last, next, newp;
+        while (1)
+        {
+            first = head.load(std::memory_order_acquire);
+            last  = tail.load(std::memory_order_acquire);
+            next  = tonode(first.node)->next.load(std::memory_order_acquire);
+
+            lf_pointer_t again = head.load(std::memory_order_acquire);
+            if ((first.node != again.node) || (first.aba_ != again.aba_)) { continue; }
+
+            if (first.node == last.node) {
+                /* queue empty (?), our cached nodes may be all that is left */
+                if (next.node == nullptr) {
+                    if (starving.load(std::memory_order_relaxed)) { flush(mags[lf_thread_index()]); }
+                    return false;
+                }
+
+                newp.node = next.node;
+                newp.aba_ = last.aba_ + 1;
+                tail.compare_exchange_weak(last, newp);
+            } else {
+                newp.node = next.node;
+                newp.aba_ = first.aba_ + 1;
+                if (head.compare_exchange_weak(first, newp)) { break; }
+            }
+        }
+
+        /* (next) is the new dummy, its value is ours: move out & destroy */
+        node_t * node = tonode(next.node);
+        object = std::move(*node->value());
+        node->value()->~T();
+
+        release(node);
+        release(tonode(first.node));
+        return true;
+    }
+
+    T pop(){
+        T object = T(); pop(object); return object;
     };
 };
 //////////////////////////////////////////////////////////////
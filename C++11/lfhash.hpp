@@ -0,0 +1,196 @@
+#include <stdint.h>
+#include <atomic>
+#include <new>
+
+#include "lfatomic.hpp"
+#include "lfmem.hpp"
+
+#ifndef __LOCKFREE_HASH_MAP_H__
+#define __LOCKFREE_HASH_MAP_H__
+
+/* slot keys of the table, the 3 largest user keys are reserved */
+#define LFHASH_EMPTY (~(uint64_t)0)        /* never used, ends a probe */
+#define LFHASH_TOMB  (~(uint64_t)0 - 1)    /* erased, reusable */
+#define LFHASH_PEND  (~(uint64_t)0 - 2)    /* insert in flight, value = its key */
+
+//////////////////////////////////////////////////////////////
+/* lock-free open addressing hash map, 64-bit keys / values */
+//////////////////////////////////////////////////////////////
+// (1 << order) slots of {key, value}, each changed with one
+// DWCAS (lf_atomic16), linear probing from fmix64(key). Keys
+// never move, and a slot never becomes EMPTY again, so a probe
+// can stop at the first EMPTY slot.
+//
+// erase turns the slot into a tombstone; lookups probe past
+// it, inserts reuse the first one of their probe. Two inserts
+// of one key may then pick different slots, so an insert
+// first claims its slot as {PEND, key}, scans the probe for
+// the same key and only then publishes {key, value}:
+//   - a live copy wins, the pending insert backs off and
+//     updates it instead;
+//   - of two pending copies the one nearer the home slot
+//     wins, it turns the other into a tombstone (the loser's
+//     publish CAS fails) or the loser retracts itself.
+// At most one live copy of a key exists at any time.
+//
+// Tombstones are never turned back into EMPTY: a table that
+// sees many distinct keys come and go ends up with long
+// probes for missing keys. Keep the load well under 1/2.
+//////////////////////////////////////////////////////////////
+class lfhash_t {
+	struct lfhash_slot_t
+	{
+		uint64_t key;
+		uint64_t val;
+	};
+
+	typedef lf_atomic16<lfhash_slot_t> slot_t;
+
+protected:
+	alignas(64) std::atomic<uint64_t> size;
+
+	uint64_t  capacity;
+	uint64_t  mask;
+	slot_t *  slots;
+	int       mflags;  /* LFMEM_* flags of (slots) */
+
+	/* murmur3 finalizer */
+	static inline uint64_t hash(uint64_t k) {
+		k ^= k >> 33; k *= 0xff51afd7ed558ccdULL;
+		k ^= k >> 33; k *= 0xc4ceb9fe1a85ec53ULL;
+		k ^= k >> 33;
+		return k;
+	};
+
+	static inline lfhash_slot_t make(uint64_t key, uint64_t val) {
+		lfhash_slot_t s; s.key = key; s.val = val; return s;
+	};
+
+	/* the probe of (key) holds another copy: false if ours at (mine) has to back off */
+	inline bool unique(uint64_t key, uint64_t home, uint64_t mine)
+	{
+		for (uint64_t n = 0; n < capacity; ++n) {
+			if (n == mine) { continue; }
+
+			uint64_t i = (home + n) & mask;
+			lfhash_slot_t s = slots[i].load(std::memory_order_acquire);
+			while (1) {
+				if (s.key == LFHASH_EMPTY) { return true; }
+				if (s.key == key) { return false; }
+				if ((s.key != LFHASH_PEND) || (s.val != key)) { break; }
+
+				/* two pending copies, the one nearer home wins */
+				if (n < mine) { return false; }
+				if (slots[i].compare_exchange_strong(s, make(LFHASH_TOMB, 0))) { break; }
+			}
+		}
+		return true;
+	};
+
+public:
+	/* (1 << order) slots; LFMEM_* (flags) backing */
+	lfhash_t(int order, int flags = 0) : size(0)
+	{
+		capacity = (1ULL << order);
+		mask     = capacity - 1;
+		mflags   = flags;
+		slots    = static_cast<slot_t *>(lfmem_alloc(sizeof(slot_t) * capacity, flags));
+		if (slots == nullptr) { throw std::bad_alloc(); };
+
+		for (uint64_t i = 0; i < capacity; ++i) { new (slots + i) slot_t(make(LFHASH_EMPTY, 0)); }
+	};
+
+	virtual ~lfhash_t() {
+		lfmem_free(slots, sizeof(slot_t) * capacity, mflags);
+	};
+
+	inline size_t getsize() { return size.load(std::memory_order_acquire);      };
+	inline bool   isempty() { return size.load(std::memory_order_acquire) == 0; };
+
+	/* move the slots to NUMA (node), only for slots mapped with (flags != 0) */
+	inline bool bind(int node) {
+		return (mflags != 0) && lfmem_bind(slots, sizeof(slot_t) * capacity, node);
+	};
+
+	/* value of (key), false if absent */
+	inline bool get(uint64_t key, uint64_t & value)
+	{
+		if (key >= LFHASH_PEND) { return false; }
+
+		uint64_t home = hash(key);
+		for (uint64_t n = 0; n < capacity; ++n) {
+			lfhash_slot_t s = slots[(home + n) & mask].load(std::memory_order_acquire);
+			if (s.key == key)          { value = s.val; return true; }
+			if (s.key == LFHASH_EMPTY) { return false; }
+		}
+		return false;
+	};
+
+	/* insert or assign, false if the table is full or (key) is reserved */
+	inline bool put(uint64_t key, uint64_t value)
+	{
+		if (key >= LFHASH_PEND) { return false; }
+
+		uint64_t home = hash(key);
+		while (1) {
+			/* an update in place, or the first free slot of the probe */
+			uint64_t      free = capacity;
+			lfhash_slot_t seen = make(LFHASH_EMPTY, 0);
+			bool          again = false;
+
+			for (uint64_t n = 0; n < capacity; ++n) {
+				slot_t & slot = slots[(home + n) & mask];
+				lfhash_slot_t s = slot.load(std::memory_order_acquire);
+
+				if (s.key == key) {
+					if (slot.compare_exchange_strong(s, make(key, value))) { return true; }
+					again = true;
+					break;
+				}
+				if ((free == capacity) && ((s.key == LFHASH_TOMB) || (s.key == LFHASH_EMPTY))) { free = n; seen = s; }
+				if (s.key == LFHASH_EMPTY) { break; }
+			}
+			if (again) { continue; }
+			if (free == capacity) { return false; }
+
+			/* claim, make sure no other copy got in, publish */
+			slot_t & slot = slots[(home + free) & mask];
+			lfhash_slot_t pend = make(LFHASH_PEND, key);
+			if (!slot.compare_exchange_strong(seen, pend)) { continue; }
+
+			if (!unique(key, home, free)) {
+				slot.compare_exchange_strong(pend, make(LFHASH_TOMB, 0));
+				continue;
+			}
+			if (slot.compare_exchange_strong(pend, make(key, value))) {
+				size.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+			/* a copy nearer home won, assign it on the next round */
+		}
+	};
+
+	/* remove (key), false if absent */
+	inline bool erase(uint64_t key)
+	{
+		if (key >= LFHASH_PEND) { return false; }
+
+		uint64_t home = hash(key);
+		for (uint64_t n = 0; n < capacity; ++n) {
+			slot_t & slot = slots[(home + n) & mask];
+			lfhash_slot_t s = slot.load(std::memory_order_acquire);
+
+			while (s.key == key) {
+				if (slot.compare_exchange_strong(s, make(LFHASH_TOMB, 0))) {
+					size.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			if (s.key == LFHASH_EMPTY) { return false; }
+		}
+		return false;
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
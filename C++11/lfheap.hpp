@@ -0,0 +1,239 @@
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "smr.hpp"
+
+#ifndef __LOCKFREE_HEAP_NODES_H__
+#define __LOCKFREE_HEAP_NODES_H__
+
+//////////////////////////////////////////////////////////////
+/* stack / queue of heap nodes under safe memory reclamation*/
+//////////////////////////////////////////////////////////////
+// Same algorithms as lfstack_t / lffifo_t (Treiber, Michael &
+// Scott), but every push allocates its node with new and every
+// pop retires it to (R): lf_hazard<K> or lf_epoch. There is no
+// capacity and no freelist, memory follows the load.
+//
+// A node is reclaimed only once no thread can still read it,
+// so a node address is never reused under a reader and plain
+// pointers replace the tagged DWCAS heads (no ABA).
+//////////////////////////////////////////////////////////////
+template <typename T> struct lf_heapnode_t
+{
+	std::atomic<lf_heapnode_t *> next;
+
+	/* raw storage, the object lives here only while queued */
+	alignas(T) unsigned char valu[sizeof(T)];
+
+	inline T * value() { return reinterpret_cast<T *>(valu); };
+};
+
+//////////////////////////////////////////////////////////////
+/* lock-free stack, heap nodes                              */
+//////////////////////////////////////////////////////////////
+template <typename T, typename R = lf_hazard<1>> class lfstack_heap_t
+{
+	typedef lf_heapnode_t<T> node_t;
+
+protected:
+	alignas(64) std::atomic<node_t *> head;
+	alignas(64) std::atomic<size_t>   size;
+
+	R smr;
+
+	static void reclaim(void *, void * p) { delete static_cast<node_t *>(p); };
+
+public:
+	lfstack_heap_t() : head(nullptr), size(0), smr(reclaim, this) { ; };
+
+	virtual ~lfstack_heap_t() {
+		/* destroy objects still in stack (no concurrent access here) */
+		node_t * node = head.load();
+		while (node != nullptr) {
+			node_t * next = node->next.load();
+			node->value()->~T();
+			delete node;
+			node = next;
+		}
+		smr.drain();
+	};
+
+	inline size_t getsize() { return size.load(std::memory_order_acquire);      };
+	inline bool   isempty() { return size.load(std::memory_order_acquire) == 0; };
+
+	/* push @ mutiple producers, false only when out of memory */
+	inline bool push(const T &  object) { return emplace(object);            };
+	inline bool push(      T && object) { return emplace(std::move(object)); };
+
+	template <typename... Args> inline bool emplace(Args &&... args)
+	{
+		node_t * node = new (std::nothrow) node_t;
+		if (node == nullptr) { return false; }
+		new (node->value()) T(std::forward<Args>(args)...);
+
+		/* a pusher never reads other nodes, no protection needed */
+		node_t * orig = head.load(std::memory_order_relaxed);
+		do {
+			node->next.store(orig, std::memory_order_relaxed);
+		} while (!head.compare_exchange_weak(orig, node, std::memory_order_release, std::memory_order_relaxed));
+
+		size.fetch_add(1);
+		return true;
+	};
+
+	/* pop @ mutiple consumers, false if empty */
+	inline bool pop(T & object)
+	{
+		node_t * node;
+
+		smr.enter();
+		while (1) {
+			node = smr.protect(0, head);
+			if (node == nullptr) { smr.leave(); return false; }
+
+			node_t * next = node->next.load(std::memory_order_relaxed);
+			if (head.compare_exchange_weak(node, next, std::memory_order_acquire, std::memory_order_relaxed)) { break; }
+		}
+		smr.leave();
+
+		/* unlinked, the object is ours; others may still read (next) */
+		object = std::move(*node->value());
+		node->value()->~T();
+		smr.retire(node);
+
+		size.fetch_sub(1);
+		return true;
+	};
+
+	/* pop @ mutiple consumers */
+	inline T pop()
+	{
+		T object = T(); pop(object); return object;
+	};
+};
+//////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+/* lock-free queue (Michael & Scott), heap nodes            */
+//////////////////////////////////////////////////////////////
+// The object of a push lives in the node linked after the
+// dummy; a pop moves it out and that node becomes the next
+// dummy, the old dummy is retired. Hazard slot 0 guards the
+// head / tail node, slot 1 its successor.
+//////////////////////////////////////////////////////////////
+template <typename T, typename R = lf_hazard<2>> class lffifo_heap_t
+{
+	typedef lf_heapnode_t<T> node_t;
+
+protected:
+	alignas(64) std::atomic<node_t *> head;
+	alignas(64) std::atomic<node_t *> tail;
+	alignas(64) std::atomic<size_t>   size;
+
+	R smr;
+
+	static void reclaim(void *, void * p) { delete static_cast<node_t *>(p); };
+
+public:
+	lffifo_heap_t() : size(0), smr(reclaim, this)
+	{
+		node_t * dummy = new node_t;
+		dummy->next.store(nullptr);
+		head.store(dummy);
+		tail.store(dummy);
+	};
+
+	virtual ~lffifo_heap_t() {
+		/* destroy objects still in queue (no concurrent access here) */
+		node_t * node = head.load();
+		node_t * next = node->next.load();
+		delete node;
+		while ((node = next) != nullptr) {
+			next = node->next.load();
+			node->value()->~T();
+			delete node;
+		}
+		smr.drain();
+	};
+
+	inline size_t getsize() { return size.load(std::memory_order_acquire);      };
+	inline bool   isempty() { return size.load(std::memory_order_acquire) == 0; };
+
+	/* push @ mutiple producers, false only when out of memory */
+	inline bool push(const T &  object) { return emplace(object);            };
+	inline bool push(      T && object) { return emplace(std::move(object)); };
+
+	template <typename... Args> inline bool emplace(Args &&... args)
+	{
+		node_t * node = new (std::nothrow) node_t;
+		if (node == nullptr) { return false; }
+		new (node->value()) T(std::forward<Args>(args)...);
+		node->next.store(nullptr, std::memory_order_relaxed);
+
+		smr.enter();
+		while (1) {
+			node_t * last = smr.protect(0, tail);
+			node_t * next = last->next.load(std::memory_order_acquire);
+			if (last != tail.load(std::memory_order_acquire)) { continue; }
+
+			if (next == nullptr) {
+				if (last->next.compare_exchange_weak(next, node, std::memory_order_release, std::memory_order_relaxed)) {
+					tail.compare_exchange_strong(last, node);
+					break;
+				}
+			} else {
+				/* help a slow pusher move the tail */
+				tail.compare_exchange_strong(last, next);
+			}
+		}
+		smr.leave();
+
+		size.fetch_add(1);
+		return true;
+	};
+
+	/* pop @ mutiple consumers, false if empty */
+	inline bool pop(T & object)
+	{
+		node_t * first;
+		node_t * next;
+
+		smr.enter();
+		while (1) {
+			first = smr.protect(0, head);
+			node_t * last = tail.load(std::memory_order_acquire);
+			next = smr.protect(1, first->next);
+			if (first != head.load(std::memory_order_acquire)) { continue; }
+
+			if (next == nullptr) { smr.leave(); return false; }
+
+			if (first == last) {
+				/* tail lags behind, help before unlinking past it */
+				tail.compare_exchange_strong(last, next);
+				continue;
+			}
+			if (head.compare_exchange_strong(first, next)) { break; }
+		}
+
+		/* (next) is the new dummy, its object is ours */
+		object = std::move(*next->value());
+		next->value()->~T();
+		smr.leave();
+
+		smr.retire(first);
+
+		size.fetch_sub(1);
+		return true;
+	};
+
+	/* pop @ mutiple consumers */
+	inline T pop()
+	{
+		T object = T(); pop(object); return object;
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
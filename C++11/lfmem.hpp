@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <new>
+#include <utility>
+
+#ifndef __LOCKFREE_MEM_HPP__
+#define __LOCKFREE_MEM_HPP__
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/* backing memory of rings and freelists                                     */
+///////////////////////////////////////////////////////////////////////////////
+// flags == 0 keeps the plain 64-byte aligned heap allocation, any flag maps
+// the region directly. Every option degrades to the next best thing instead
+// of failing:
+//   LFMEM_HUGEPAGE : 2 MiB pages (MAP_HUGETLB / MEM_LARGE_PAGES), else
+//                    normal pages with a transparent huge page hint
+//   LFMEM_POPULATE : fault every page in now, not in the hot path later
+//   LFMEM_LOCK     : mlock / VirtualLock, ignored above RLIMIT_MEMLOCK
+//   LFMEM_MAP      : nothing else, only map the pages (never calls malloc)
+//   LFMEM_NODE(n)  : bind the pages to NUMA node (n) before they are
+//                    touched (raw mbind, VirtualAllocExNuma on windows)
+// lfmem_free must be given the same (size, flags) as lfmem_alloc.
+///////////////////////////////////////////////////////////////////////////////
+#define LFMEM_HUGEPAGE   (0x1)
+#define LFMEM_POPULATE   (0x2)
+#define LFMEM_LOCK       (0x4)
+#define LFMEM_MAP        (0x8)
+
+/* node (n) in [0, 254] is kept in bits 8..15 as (n + 1), 0 means no node */
+#define LFMEM_NODE(n)       ((((n) + 1) & 0xff) << 8)
+#define LFMEM_NODEOF(flags) ((((flags) >> 8) & 0xff) - 1)
+#define LFMEM_MAXNODES      (256)
+
+#define LFMEM_HUGESIZE   (2UL << 20)
+
+static inline size_t lfmem_round(size_t size, size_t align)
+{
+	return ((size + align - 1) / align) * align;
+}
+
+static inline size_t lfmem_pagesize()
+{
+#ifdef _WIN32
+	SYSTEM_INFO si; GetSystemInfo(&si);
+	return (size_t)si.dwPageSize;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+/* size of the region actually reserved for (size, flags) */
+static inline size_t lfmem_size(size_t size, int flags)
+{
+	if (flags == 0) { return lfmem_round(size, 64); }
+	if (flags & LFMEM_HUGEPAGE) { return lfmem_round(size, LFMEM_HUGESIZE); }
+	return lfmem_round(size, lfmem_pagesize());
+}
+
+/* write one byte per page so that every page is backed now */
+static inline void lfmem_touch(void* p, size_t size)
+{
+	for (size_t i = 0; i < size; i += 4096) {
+		((volatile unsigned char*)p)[i] = 0;
+	}
+}
+
+#ifdef _WIN32
+
+/* NUMA node of the calling thread's current cpu */
+static inline int lfmem_current_node()
+{
+	PROCESSOR_NUMBER pn;
+	USHORT node = 0;
+
+	GetCurrentProcessorNumberEx(&pn);
+	return GetNumaProcessorNodeEx(&pn, &node) ? (int)node : 0;
+}
+
+/* pages cannot be moved after the fact here, pass LFMEM_NODE() instead */
+static inline bool lfmem_bind(void* p, size_t size, int node)
+{
+	return false;
+}
+
+static inline void* lfmem_valloc(size_t len, DWORD type, int node)
+{
+	if (node < 0) { return VirtualAlloc(NULL, len, type, PAGE_READWRITE); }
+	return VirtualAllocExNuma(GetCurrentProcess(), NULL, len, type, PAGE_READWRITE, (DWORD)node);
+}
+
+static inline void* lfmem_alloc(size_t size, int flags)
+{
+	size_t len  = lfmem_size(size, flags);
+	int    node = LFMEM_NODEOF(flags);
+	void*  p    = nullptr;
+
+	if (flags == 0) { return _aligned_malloc(len, 64); }
+
+	/* needs SeLockMemoryPrivilege, quietly falls back without it */
+	if ((flags & LFMEM_HUGEPAGE) && (GetLargePageMinimum() != 0)) {
+		p = lfmem_valloc(
+			lfmem_round(len, GetLargePageMinimum()),
+			MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, node
+		);
+	}
+	if (p == nullptr) {
+		p = lfmem_valloc(len, MEM_RESERVE | MEM_COMMIT, node);
+		if (p == nullptr) { return nullptr; }
+		if (flags & LFMEM_POPULATE) { lfmem_touch(p, len); }
+	}
+
+	if (flags & LFMEM_LOCK) { VirtualLock(p, len); }
+	return p;
+}
+
+static inline void lfmem_free(void* p, size_t size, int flags)
+{
+	if (p == nullptr) { return; }
+	if (flags == 0) { _aligned_free(p); return; }
+	VirtualFree(p, 0, MEM_RELEASE);
+}
+
+#else
+
+/** OSX needs some help here */
+#ifndef MAP_ANONYMOUS
+#  define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* linux/mempolicy.h values, so that no libnuma is needed */
+#define LFMEM_MPOL_BIND     (2)
+#define LFMEM_MPOL_MF_MOVE  (1 << 1)
+
+/* NUMA node of the calling thread's current cpu */
+static inline int lfmem_current_node()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned cpu = 0, node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) { return (int)node; }
+#endif
+	return 0;
+}
+
+/* bind the pages of [p, p + size) to (node), pages already touched by   */
+/* this process only are migrated; p must be page aligned (mapped, i.e. */
+/* allocated with flags != 0). false if there is no NUMA support.       */
+static inline bool lfmem_bind(void* p, size_t size, int node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	unsigned long mask[LFMEM_MAXNODES / (8 * sizeof(unsigned long))] = {};
+	if ((node < 0) || (node >= LFMEM_MAXNODES)) { return false; }
+
+	mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+	return syscall(
+		SYS_mbind, p, lfmem_round(size, lfmem_pagesize()),
+		LFMEM_MPOL_BIND, mask, LFMEM_MAXNODES + 1, LFMEM_MPOL_MF_MOVE
+	) == 0;
+#else
+	return false;
+#endif
+}
+
+static inline void* lfmem_alloc(size_t size, int flags)
+{
+	size_t len  = lfmem_size(size, flags);
+	int    node = LFMEM_NODEOF(flags);
+	void*  p    = MAP_FAILED;
+	int    pop  = 0;
+
+	if (flags == 0) { return aligned_alloc(64, len); }
+
+#ifdef MAP_POPULATE
+	/* with a node, pages are faulted in only once the policy is set */
+	if ((flags & LFMEM_POPULATE) && (node < 0)) { pop = MAP_POPULATE; }
+#endif
+
+#ifdef MAP_HUGETLB
+	/* explicit huge pages, only if the admin reserved some */
+	if (flags & LFMEM_HUGEPAGE) {
+		p = mmap(
+			NULL, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | pop, -1, 0
+		);
+	}
+#endif
+
+	if (p == MAP_FAILED) {
+		/* transparent huge pages: hint first, fault in after */
+		if (flags & LFMEM_HUGEPAGE) { pop = 0; }
+
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | pop, -1, 0);
+		if (p == MAP_FAILED) { return nullptr; }
+#ifdef MADV_HUGEPAGE
+		if (flags & LFMEM_HUGEPAGE) { madvise(p, len, MADV_HUGEPAGE); }
+#endif
+	}
+
+	if (node >= 0) { lfmem_bind(p, len, node); }
+	if ((flags & LFMEM_POPULATE) && (pop == 0)) { lfmem_touch(p, len); }
+	if (flags & LFMEM_LOCK) { mlock(p, len); }
+	return p;
+}
+
+static inline void lfmem_free(void* p, size_t size, int flags)
+{
+	if (p == nullptr) { return; }
+	if (flags == 0) { free(p); return; }
+	munmap(p, lfmem_size(size, flags));
+}
+
+#endif // _WIN32
+
+/* construct a whole object (a queue with its head/tail lines) in memory */
+/* of (flags), e.g. on the node of the threads that hammer its indices   */
+template <typename Q, typename... Args> static inline Q * lfmem_new(int flags, Args &&... args)
+{
+	void * p = lfmem_alloc(sizeof(Q), flags);
+	if (p == nullptr) { throw std::bad_alloc(); }
+	try {
+		return new (p) Q(std::forward<Args>(args)...);
+	}
+	catch (...) {
+		lfmem_free(p, sizeof(Q), flags); throw;
+	}
+}
+
+template <typename Q> static inline void lfmem_delete(Q * q, int flags)
+{
+	if (q == nullptr) { return; }
+	q->~Q();
+	lfmem_free(q, sizeof(Q), flags);
+}
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
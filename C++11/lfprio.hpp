@@ -0,0 +1,277 @@
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "lffifo.hpp"
+#include "lfmem.hpp"
+#include "lfthread.hpp"
+#include "smr.hpp"
+
+#ifndef __LOCKFREE_PRIORITY_QUEUE_H__
+#define __LOCKFREE_PRIORITY_QUEUE_H__
+
+/* skiplist levels at most, plenty for 1 << LFPRIO_LEVELS nodes */
+#ifndef LFPRIO_LEVELS
+#define LFPRIO_LEVELS 16
+#endif
+
+//////////////////////////////////////////////////////////////
+/* lock-free priority queue (skiplist, Lotan & Shavit)      */
+//////////////////////////////////////////////////////////////
+// A lock-free skiplist (Fraser / Herlihy & Shavit: a deleted
+// node has the low bit set in its own next pointers, searches
+// unlink what they pass) ordered by (key, push sequence), so
+// equal keys pop in push order and every node is unique.
+//
+// pop walks level 0 from the head and claims the first node
+// it can mark there; that is the smallest key at some moment
+// of the walk, but a push of a smaller key behind the walk is
+// not seen (quiescently consistent, not linearizable). The
+// winner marks the upper levels and searches the key once to
+// unlink the node everywhere.
+//
+// Nodes come from a (1 << order) array on the lfstack freelist
+// (lffifo.hpp), push fails when it runs dry. An unlinked node
+// goes back through lf_epoch, so no search can still stand on
+// it when it is reused: it is retired by whichever of its
+// pusher and popper finishes last (a pop may take a node whose
+// push is still linking the upper levels). A push that finds
+// the freelist dry moves the epoch on until its own retired
+// nodes come back; up to about LF_SMR_BATCH nodes retired by
+// every other thread may still wait there.
+//////////////////////////////////////////////////////////////
+template <typename T> struct lfprio_node_t
+{
+	lf_pointer_t           link;   /* freelist link, first member */
+	uint64_t               key;    /* priority, smallest first */
+	uint64_t               seq;    /* push order, breaks ties */
+	int                    level;  /* links in use, [1, LFPRIO_LEVELS] */
+	std::atomic<uint32_t>  done;   /* pusher + popper finished, 2 = retire */
+	std::atomic<uintptr_t> next[LFPRIO_LEVELS];  /* low bit: deleted */
+
+	/* raw storage, the object lives here only while the node is queued */
+	alignas(T) unsigned char valu[sizeof(T)];
+
+	inline T * value() { return reinterpret_cast<T *>(valu); };
+};
+
+template <typename T> class lfprio_t {
+	typedef lfprio_node_t<T> node_t;
+
+protected:
+	alignas(64) lf_atomic_pointer_t       freelist;
+	alignas(64) std::atomic<uint64_t>     seq;
+	alignas(64) std::atomic<uint64_t>     size;
+	alignas(64) node_t                    head;  /* key never read */
+
+	lf_epoch                smr;
+
+	uint64_t                capacity;
+	node_t *                nodes;
+	int                     levels;  /* levels in use, about order */
+	int                     mflags;  /* LFMEM_* flags of (nodes) */
+
+	static inline node_t *  ptr(uintptr_t w)    { return reinterpret_cast<node_t *>(w & ~(uintptr_t)1); };
+	static inline bool      marked(uintptr_t w) { return (w & 1) != 0; };
+	static inline uintptr_t word(node_t * n)    { return reinterpret_cast<uintptr_t>(n); };
+
+	/* (n) orders before (key, sq) */
+	static inline bool before(const node_t * n, uint64_t key, uint64_t sq) {
+		return (n->key < key) || ((n->key == key) && (n->seq < sq));
+	};
+
+	static void reclaim(void * ctx, void * p) {
+		lfstack_push_internal(&(static_cast<lfprio_t *>(ctx)->freelist), static_cast<lf_pointer_t *>(p));
+	};
+
+	/* both the pusher and the popper are done with (node) */
+	inline void release(node_t * node) {
+		if (node->done.fetch_add(1, std::memory_order_acq_rel) == 1) { smr.retire(node); }
+	};
+
+	/* geometric, p = 1/2 */
+	inline int randomlevel()
+	{
+		thread_local uint32_t seed = (uint32_t)(lf_thread_index() + 1) * 0x9E3779B9u;
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+
+		int      l = 1;
+		uint32_t r = seed;
+		while ((r & 1) && (l < levels)) { ++l; r >>= 1; }
+		return l;
+	};
+
+	/* one search, false if an unlink lost its CAS and it must start over */
+	inline bool search(uint64_t key, uint64_t sq, node_t ** preds, node_t ** succs)
+	{
+		node_t * pred = &head;
+		for (int l = levels - 1; l >= 0; --l) {
+			node_t * curr = ptr(pred->next[l].load(std::memory_order_acquire));
+			while (curr != nullptr) {
+				uintptr_t succ = curr->next[l].load(std::memory_order_acquire);
+				if (marked(succ)) {
+					uintptr_t expect = word(curr);
+					if (!pred->next[l].compare_exchange_strong(expect, succ & ~(uintptr_t)1)) { return false; }
+					curr = ptr(succ);
+					continue;
+				}
+				if (!before(curr, key, sq)) { break; }
+				pred = curr;
+				curr = ptr(succ);
+			}
+			preds[l] = pred;
+			succs[l] = curr;
+		}
+		return true;
+	};
+
+	/* predecessors / successors of (key, sq) on every level, deleted nodes on the way unlinked */
+	inline void find(uint64_t key, uint64_t sq, node_t ** preds, node_t ** succs) {
+		while (!search(key, sq, preds, succs)) { ; }
+	};
+
+public:
+	/* (1 << order) nodes; LFMEM_* (flags) backing */
+	lfprio_t(int order, int flags = 0) : freelist(lf_pointer_t()), seq(0), size(0), smr(reclaim, this)
+	{
+		/* allocate memory */
+		capacity = (1ULL << order);
+		levels   = (order < 1) ? 1 : ((order > LFPRIO_LEVELS) ? LFPRIO_LEVELS : order);
+		mflags   = flags;
+		nodes    = static_cast<node_t *>(lfmem_alloc(sizeof(node_t) * capacity, flags));
+		if (nodes == nullptr) { throw std::bad_alloc(); };
+
+		for (int l = 0; l < LFPRIO_LEVELS; ++l) { head.next[l].store(0, std::memory_order_relaxed); }
+
+		/* initialize freelist */
+		for (uint64_t i = 0; i < capacity; ++i) {
+			lfstack_push_internal(&freelist, &(nodes[i].link));
+		}
+	};
+
+	virtual ~lfprio_t() {
+		/* destroy objects still queued (no concurrent access here) */
+		if (!std::is_trivially_destructible<T>::value) {
+			for (node_t * node = ptr(head.next[0].load()); node != nullptr; node = ptr(node->next[0].load())) {
+				if (!marked(node->next[0].load())) { node->value()->~T(); }
+			}
+		}
+		smr.drain();
+		lfmem_free(nodes, sizeof(node_t) * capacity, mflags);
+	};
+
+	inline size_t getsize() { return size.load(std::memory_order_acquire);      };
+	inline bool   isempty() { return size.load(std::memory_order_acquire) == 0; };
+
+	/* move the nodes to NUMA (node), only for nodes mapped with (flags != 0) */
+	inline bool bind(int node) {
+		return (mflags != 0) && lfmem_bind(nodes, sizeof(node_t) * capacity, node);
+	};
+
+	/* push @ mutiple producers, smallest (key) pops first; false if no node is free */
+	inline bool push(uint64_t key, const T &  object) { return emplace(key, object);            };
+	inline bool push(uint64_t key,       T && object) { return emplace(key, std::move(object)); };
+
+	template <typename... Args> inline bool emplace(uint64_t key, Args &&... args)
+	{
+		node_t * node = reinterpret_cast<node_t *>(lfstack_pop_internal(&freelist));
+		if (node == nullptr) {
+			/* our own retired nodes, once the epoch moved on past them */
+			smr.poll();
+			node = reinterpret_cast<node_t *>(lfstack_pop_internal(&freelist));
+			if (node == nullptr) { return false; }
+		}
+		new (node->value()) T(std::forward<Args>(args)...);
+		node->key   = key;
+		node->seq   = seq.fetch_add(1, std::memory_order_relaxed);
+		node->level = randomlevel();
+		node->done.store(0, std::memory_order_relaxed);
+
+		node_t * preds[LFPRIO_LEVELS];
+		node_t * succs[LFPRIO_LEVELS];
+
+		smr.enter();
+
+		/* level 0 makes it visible, every link is set before */
+		while (1) {
+			find(node->key, node->seq, preds, succs);
+			for (int l = 0; l < node->level; ++l) { node->next[l].store(word(succs[l]), std::memory_order_relaxed); }
+
+			uintptr_t expect = word(succs[0]);
+			if (preds[0]->next[0].compare_exchange_strong(expect, word(node), std::memory_order_release, std::memory_order_relaxed)) { break; }
+		}
+		size.fetch_add(1, std::memory_order_release);
+
+		/* upper levels, until a pop claims the node (only a pop marks its links) */
+		bool claimed = false;
+		for (int l = 1; (l < node->level) && !claimed; ++l) {
+			while (1) {
+				uintptr_t link = node->next[l].load(std::memory_order_acquire);
+				if (marked(link) || ((ptr(link) != succs[l]) && !node->next[l].compare_exchange_strong(link, word(succs[l])))) {
+					claimed = true;
+					break;
+				}
+
+				uintptr_t expect = word(succs[l]);
+				if (preds[l]->next[l].compare_exchange_strong(expect, word(node))) { break; }
+				find(node->key, node->seq, preds, succs);
+			}
+		}
+
+		/* popped meanwhile: the pop may have searched before a link above, unlink it again */
+		if (marked(node->next[0].load(std::memory_order_acquire))) { find(node->key, node->seq, preds, succs); }
+
+		smr.leave();
+		release(node);
+		return true;
+	};
+
+	/* pop @ mutiple consumers, the smallest key; false if empty */
+	inline bool pop(T & object, uint64_t * key = nullptr)
+	{
+		smr.enter();
+
+		/* claim the first node not deleted yet */
+		node_t * node = ptr(head.next[0].load(std::memory_order_acquire));
+		while (1) {
+			if (node == nullptr) { smr.leave(); return false; }
+
+			uintptr_t succ = node->next[0].load(std::memory_order_acquire);
+			if (marked(succ)) { node = ptr(succ); continue; }
+			if (node->next[0].compare_exchange_strong(succ, succ | 1, std::memory_order_acq_rel, std::memory_order_acquire)) { break; }
+		}
+
+		/* claimed, the object is ours */
+		object = std::move(*node->value());
+		node->value()->~T();
+		if (key != nullptr) { *key = node->key; }
+		size.fetch_sub(1, std::memory_order_release);
+
+		/* delete the upper levels, top down, then unlink everywhere */
+		for (int l = node->level - 1; l >= 1; --l) {
+			uintptr_t link = node->next[l].load(std::memory_order_acquire);
+			while (!marked(link) && !node->next[l].compare_exchange_weak(link, link | 1)) { ; }
+		}
+
+		node_t * preds[LFPRIO_LEVELS];
+		node_t * succs[LFPRIO_LEVELS];
+		find(node->key, node->seq, preds, succs);
+
+		smr.leave();
+		release(node);
+		return true;
+	};
+
+	/* pop @ mutiple consumers */
+	inline T pop()
+	{
+		T object = T(); pop(object); return object;
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
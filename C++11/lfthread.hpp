@@ -0,0 +1,73 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+
+#ifndef __LOCKFREE_THREAD_INDEX_H__
+#define __LOCKFREE_THREAD_INDEX_H__
+
+/* spin-wait hint to the core (and its SMT sibling) */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+static inline void cpu_relax() { _mm_pause(); }
+#elif defined(__aarch64__)
+static inline void cpu_relax() { __asm__ __volatile__("yield"); }
+#else
+static inline void cpu_relax() { ; }
+#endif
+
+//////////////////////////////////////////////////////////////
+/* dense per-thread index in [0, LF_MAXTHREADS)             */
+//////////////////////////////////////////////////////////////
+// Used to pick a home lane / a per-thread slot without any
+// shared counter on the hot path. An index is taken from a
+// bitmap on the first call of a thread and given back when
+// the thread exits, so only *live* threads count against
+// LF_MAXTHREADS (running out is a configuration error).
+//////////////////////////////////////////////////////////////
+#ifndef LF_MAXTHREADS
+#define LF_MAXTHREADS 128
+#endif
+
+inline std::atomic<uint64_t> lf_thread_bitmap[(LF_MAXTHREADS + 63) / 64];
+
+class lf_thread_id
+{
+	int index;
+
+public:
+	lf_thread_id() : index(-1)
+	{
+		for (int w = 0; w < (LF_MAXTHREADS + 63) / 64; ++w)
+		{
+			uint64_t bits = lf_thread_bitmap[w].load(std::memory_order_relaxed);
+			for (int b = 0; b < 64 && (w * 64 + b) < LF_MAXTHREADS; )
+			{
+				if (bits & (1ULL << b)) { ++b; continue; }
+				if (lf_thread_bitmap[w].compare_exchange_weak(bits, bits | (1ULL << b))) {
+					index = w * 64 + b; return;
+				}
+				/* bits reloaded, rescan this word */
+				b = 0;
+			}
+		}
+
+		/* more than LF_MAXTHREADS live threads */
+		abort();
+	};
+
+	~lf_thread_id()
+	{
+		lf_thread_bitmap[index / 64].fetch_and(~(1ULL << (index % 64)));
+	};
+
+	inline int get() const { return index; };
+};
+
+static inline int lf_thread_index()
+{
+	thread_local lf_thread_id id;
+	return id.get();
+}
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
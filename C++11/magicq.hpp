@@ -1,45 +1,91 @@
 #include <atomic>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "lfmem.hpp"
+
 #ifndef __LOCKFREE_MAGICQ_SPSC_H__
 #define __LOCKFREE_MAGICQ_SPSC_H__
 
+//////////////////////////////////////////////////////////////
+/* single producer single consumer ring                     */
+//////////////////////////////////////////////////////////////
+// head is written by the consumer only, tail by the producer
+// only, each on its own cache line next to a private cached
+// copy of the other side's index. The other side's line is
+// re-read only when the cached copy says full (empty), so
+// the line ping-pong is about once per batch, not per object.
+//////////////////////////////////////////////////////////////
 template <typename T> class magicq
 {
 protected:
-	std::atomic<uint64_t> nobj;
+	/* consumer line */
+	alignas(64) std::atomic<uint64_t> head;
+	uint64_t tailcache;
 
-	uint64_t head;
-	uint64_t tail;
+	/* producer line */
+	alignas(64) std::atomic<uint64_t> tail;
+	uint64_t headcache;
 
-	size_t   size;
-	T *      data;
+	alignas(64) size_t size;
+	T * data;   /* raw storage, objects live in [head, tail) */
+	int mflags; /* LFMEM_* flags of (data) */
 	
 	magicq() { ; };
 public:
-	magicq(int order) : nobj(0) {
-		size = (1ULL << order);
-		data = new T[size];
-
-		head = 0;
-		tail = 0;
+	/* (flags): LFMEM_HUGEPAGE / LFMEM_POPULATE / LFMEM_LOCK backing */
+	magicq(int order, int flags = 0) : head(0), tailcache(0), tail(0), headcache(0) {
+		size   = (1ULL << order);
+		mflags = flags;
+		data   = static_cast<T *>(lfmem_alloc(sizeof(T) * size, flags));
+		if (data == nullptr) { throw std::bad_alloc(); }
 	};
 
 	virtual ~magicq() {
-		delete[] data;
+		if (!std::is_trivially_destructible<T>::value) {
+			uint64_t _tail = tail.load();
+			for (uint64_t i = head.load(); i < _tail; ++i) {
+				data[i & (size - 1)].~T();
+			}
+		}
+		lfmem_free(data, sizeof(T) * size, mflags);
 	};
 
-	inline bool isfull() { return (nobj.load(std::memory_order_acquire) == size); }
-	inline bool isempty() { return (nobj.load(std::memory_order_acquire) == 0); }
-	inline size_t getsize() { return nobj.load(std::memory_order_acquire); };
+	inline bool isfull() {
+		return (tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire) >= size);
+	}
+	inline bool isempty() {
+		return (tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire));
+	}
+	/* move the ring to NUMA (node), e.g. lfmem_current_node() of the *
+	 * consumer; only for rings mapped with (flags != 0)               */
+	inline bool bind(int node) {
+		return (mflags != 0) && lfmem_bind(data, sizeof(T) * size, node);
+	};
+
+	inline size_t getsize() {
+		uint64_t _head = head.load(std::memory_order_acquire);
+		return (size_t)(tail.load(std::memory_order_acquire) - _head);
+	};
 
 	/* push @ single producer single consumer */
-	inline bool push(const T & object)
+	inline bool push(const T &  object) { return emplace(object);            };
+	inline bool push(      T && object) { return emplace(std::move(object)); };
+
+	/* construct the object in place @ single producer single consumer */
+	template <typename... Args> inline bool emplace(Args &&... args)
 	{
-		if (isfull()) { return false; }
+		uint64_t _tail = tail.load(std::memory_order_relaxed);
+		if (_tail - headcache >= size) {
+			/* looks full, refresh the consumer's index */
+			headcache = head.load(std::memory_order_acquire);
+			if (_tail - headcache >= size) { return false; }
+		}
 
-		/* copy object (move) */
-		data[tail] = object;
-		tail = (tail + 1) & (size - 1);
-		nobj.fetch_add(1);
+		new (data + (_tail & (size - 1))) T(std::forward<Args>(args)...);
+		tail.store(_tail + 1, std::memory_order_release);
 
 		return true;
 	}
@@ -47,12 +93,18 @@ public:
 	/* pop @ single producer single consumer */
 	inline bool pop(T & object)
 	{
-		if (isempty()) { return false; }
+		uint64_t _head = head.load(std::memory_order_relaxed);
+		if (_head == tailcache) {
+			/* looks empty, refresh the producer's index */
+			tailcache = tail.load(std::memory_order_acquire);
+			if (_head == tailcache) { return false; }
+		}
 
-		/* copy object, move should be used here */
-		object = data[head];
-		head = (head + 1) & (size - 1);
-		nobj.fetch_sub(1);
+		/* move the object out and destroy it in place */
+		T * pobj = data + (_head & (size - 1));
+		object = std::move(*pobj);
+		pobj->~T();
+		head.store(_head + 1, std::memory_order_release);
 
 		return (true);
 	};
@@ -60,7 +112,7 @@ public:
 	/* pop @ single producer single consumer */
 	inline T pop()
 	{
-		T object(0); pop(object); return object;
+		T object = T(); pop(object); return object;
 	};
 };
 
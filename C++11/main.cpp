@@ -1,351 +1,1205 @@
 #include <stdio.h>
-#include <time.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <deque>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "magicq.hpp"
+#include "rbq.hpp"
+#include "rbqlanes.hpp"
+#include "rbqlist.hpp"
+#include "wfqueue.hpp"
+#include "lffifo.hpp"
+#include "lfheap.hpp"
+#include "lfprio.hpp"
+#include "lfhash.hpp"
+#include "wsdeque.hpp"
+#include "lfexec.hpp"
+
+/* ffbench: every structure in one binary, picked at run time.
+
+   ffbench -s rbqueue,lffifo -p 1,2,4 -c 1,2,4 -d 2 -f csv > runs.csv
+
+   Every list option (-s -p -c -m -t -b -r) takes comma separated values,
+   one run per combination. Structures come in four kinds:
+     queue  producers (-p) push, consumers (-c) pop, hybrids (-m) push
+            a batch (-k) then pop a batch; the xor of everything pushed
+            must match the xor of everything popped or drained
+     hash   (-t) threads get / put / erase keys, (-r) % gets
+     steal  one owner pushes and pops a batch, (-t) - 1 thieves steal
+     pool   (-t) workers run waves of (1 << order) tasks submitted from
+            outside (inject) or spawned by the tasks (spawn), or time
+            fan-out/fan-in rounds of 64 (fanout)
+   ffbench -L lists them.
+*/
+
+#define FANOUT       64          /* pool: tasks of a fan-out/fan-in round */
+#define BACKLOG(c)   (4ULL << (c).order)  /* queue: producers wait above it */
+
+typedef struct benchconf {
+    int     producers;
+    int     consumers;
+    int     hybrids;
+    int     threads;   /* hash, steal, pool */
+    int     order;     /* (1 << order) slots / nodes */
+    int     payload;   /* bytes of an element */
+    int     batch;     /* hybrid and steal owner: pushes, then pops */
+    int     reads;     /* hash: % of gets */
+    double  seconds;
+} benchconf;
+
+typedef struct benchresult {
+    uint64_t ops;      /* successful pushes + pops (gets / puts / erases, tasks) */
+    double   seconds;  /* wall time of the run */
+    int      active;   /* threads doing the ops */
+    bool     ok;       /* nothing lost, nothing duplicated */
+    uint64_t lat[4];   /* ns, p50/p99/p99.9/max, -l (pool: always, per round / wave) */
+} benchresult;
+
+
+/*
+*  Run control
+*/
+
+std::atomic<bool> benchgo(false);
+std::atomic<bool> benchstop(false);
+
+bool  latency = false;   /* -l */
+
+static inline void waitgo()
+{
+    while (!benchgo.load(std::memory_order_acquire)) { sched_yield(); }
+}
+
+static inline bool stopped()
+{
+    return benchstop.load(std::memory_order_relaxed);
+}
+
+/* let the threads go, stop them after (seconds), wall time in between */
+static inline double runfor(double seconds)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    benchgo.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    benchstop.store(true, std::memory_order_release);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static inline void runreset()
+{
+    benchgo.store(false);
+    benchstop.store(false);
+}
+
+
+/*
+*  Latency histogram
+*/
+
+/* ns histogram, 8 sub-buckets per power of 2 */
+#define LATBUCKETS   (64 * 8)
+
+uint64_t lathist[LATBUCKETS];
+thread_local uint64_t latlocal[LATBUCKETS];
+thread_local std::chrono::steady_clock::time_point latstart;
+
+static inline int latbucket(uint64_t ns)
+{
+    if (ns < 8) { return (int)ns; }
 #ifdef _WIN32
-#include <Windows.h>
-#define THRRET  DWORD WINAPI
+    unsigned long msb; _BitScanReverse64(&msb, ns);
+    int e = (int)msb;
+#else
+    int e = 63 - __builtin_clzll(ns);
+#endif
+    return (e - 2) * 8 + (int)((ns >> (e - 3)) & 7);
+}
+
+static inline uint64_t latvalue(int b)
+{
+    if (b < 8) { return b; }
+    int e = b / 8 + 2;
+    return ((uint64_t)(8 + (b & 7))) << (e - 3);
+}
 
-static inline int sleep(int sec)
+static inline void latrecord(uint64_t ns)
 {
-    Sleep(sec);
-    return (0);
+    latlocal[latbucket(ns)]++;
 }
+
+static inline void latbegin()
+{
+    if (latency) { latstart = std::chrono::steady_clock::now(); }
+}
+
+static inline void latend()
+{
+    if (latency) {
+        latrecord((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - latstart).count());
+    }
+}
+
+/* merge the histogram of this thread */
+static inline void latmerge()
+{
+    for (int b = 0; b < LATBUCKETS; ++b) {
+        if (latlocal[b] == 0) { continue; }
+#ifdef _WIN32
+        InterlockedExchangeAdd64((volatile LONG64 *)&lathist[b], (LONG64)latlocal[b]);
 #else
-#include <unistd.h>
-#include <pthread.h>
-#define THRRET  void *
+        __sync_fetch_and_add(&lathist[b], latlocal[b]);
 #endif
+        latlocal[b] = 0;
+    }
+}
+
+/* p50/p99/p99.9/max of the merged histogram, cleared for the next run */
+static inline void latreport(uint64_t * lat)
+{
+    const double q[4] = { 0.50, 0.99, 0.999, 1.0 };
+    uint64_t total = 0, seen = 0;
+    int b = 0;
 
-/* MODE 0: SPSC RING BUFFER QUEUE
-   MODE 1: MPMC RING BUFFER QUEUE
-   MODE 2: LOCK FREE STACK
-   MODE 3: LOCK FREE FIFO (MSQUE)
+    for (int i = 0; i < LATBUCKETS; ++i) { total += lathist[i]; }
+    for (int k = 0; k < 4; ++k) {
+        if (total == 0) { lat[k] = 0; continue; }
+        while ((b < LATBUCKETS) && ((seen + lathist[b]) < (uint64_t)(q[k] * total) || lathist[b] == 0)) { seen += lathist[b++]; }
+        lat[k] = latvalue(b < LATBUCKETS ? b : LATBUCKETS - 1);
+    }
+    for (int i = 0; i < LATBUCKETS; ++i) { lathist[i] = 0; }
+}
+
+
+/*
+*  Elements and baselines
 */
-#define TESTMODE     1
-#define MAXTHREADS   8
-#define MAXITER      8
 
-#define LIMIT        5000000
+/* an element of (N) bytes, (v) carries the checksum */
+template <int N> struct payload {
+    uint64_t      v;
+    unsigned char pad[N - sizeof(uint64_t)];
 
-typedef struct pont {
-    long  limit;
-    long  stopped;
-    long  duration;
-} pont;
+    payload() = default;
+    payload(uint64_t x) : v(x) { ; }
+};
 
-#if (TESTMODE == 0)
-#include "magicq.hpp"
+template <> struct payload<8> {
+    uint64_t      v;
 
-typedef magicq<uint64_t> pile;
+    payload() = default;
+    payload(uint64_t x) : v(x) { ; }
+};
 
-#define INIT(f)
-#define FREE(f)
+/* random priorities in [0, 1024) */
+static inline uint64_t benchkey()
+{
+    thread_local uint32_t seed = (uint32_t)(uintptr_t)&seed | 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed & 1023;
+}
 
-#define PUSH(f, val) ((f)->push((uint64_t)val))
-#define POP(f)       ((void *)((f)->pop()))
+/* what lfprio_t replaces: std::priority_queue under a mutex */
+template <typename T> class mutexprio {
+    struct item {
+        uint64_t key;
+        uint64_t seq;  /* push order, breaks ties */
+        T        val;
 
-#define SIZE(f)      ((f)->getsize())
+        inline bool operator>(const item & o) const {
+            return (key > o.key) || ((key == o.key) && (seq > o.seq));
+        }
+    };
 
-pile  gstack(12);
+    std::priority_queue<item, std::vector<item>, std::greater<item>> q;
+    std::mutex m;
+    uint64_t   seq = 0;
 
-#elif (TESTMODE == 1)
-#include "rbq.hpp"
+public:
+    inline bool push(uint64_t key, const T & val) {
+        std::lock_guard<std::mutex> lock(m);
+        q.push(item{ key, seq++, val });
+        return true;
+    }
 
-typedef rbqueue<uint64_t> pile;
+    inline bool pop(T & val) {
+        std::lock_guard<std::mutex> lock(m);
+        if (q.empty()) { return false; }
+        val = q.top().val;
+        q.pop();
+        return true;
+    }
+};
 
-#define INIT(f)
-#define FREE(f)
+/* what lfhash_t replaces: std::unordered_map under a mutex */
+class mutexhash {
+    std::unordered_map<uint64_t, uint64_t> m;
+    std::mutex lock;
 
-#define PUSH(f, val) ((f)->push((uint64_t)val))
-#define POP(f)       ((void *)((f)->pop()))
+public:
+    mutexhash(int) { ; }
 
-#define SIZE(f)      ((f)->getsize())
+    inline bool put(uint64_t key, uint64_t val) {
+        std::lock_guard<std::mutex> guard(lock);
+        m[key] = val;
+        return true;
+    }
 
-pile  gstack(12);
+    inline bool get(uint64_t key, uint64_t & val) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = m.find(key);
+        if (it == m.end()) { return false; }
+        val = it->second;
+        return true;
+    }
 
-#elif (TESTMODE == 2)
-#include "lffifo.hpp"
+    inline bool erase(uint64_t key) {
+        std::lock_guard<std::mutex> guard(lock);
+        return m.erase(key) != 0;
+    }
 
-typedef lfstack_t<uint64_t> pile;
+    inline size_t getsize() {
+        std::lock_guard<std::mutex> guard(lock);
+        return m.size();
+    }
+};
 
-#define INIT(f)      
-#define FREE(f)      
+/* what lfexecutor_t replaces: one std::deque of tasks under a mutex, idle workers wait on a condition variable */
+class mutexpool {
+    std::deque<lftask_t *>   q;
+    std::mutex               m;
+    std::condition_variable  cv;
+    std::vector<std::thread> workers;
+    bool                     stopping;
 
-#define PUSH(f, val) ((f)->push((uint64_t)(val)))
-#define POP(f)       ((void *)((f)->pop()))
+    void loop() {
+        while (1) {
+            lftask_t * task;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [this] { return stopping || !q.empty(); });
+                if (q.empty()) { return; }
+                task = q.front();
+                q.pop_front();
+            }
+            task->run();
+        }
+    }
 
-#define SIZE(f)      ((f)->getsize())
+public:
+    mutexpool(int threads, int) : stopping(false) {
+        for (int i = 0; i < threads; ++i) { workers.emplace_back(&mutexpool::loop, this); }
+    }
 
-pile gstack(12);
-#endif
+    ~mutexpool() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto & t : workers) { t.join(); }
+    }
+
+    inline void submit(lftask_t * task) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            q.push_back(task);
+        }
+        cv.notify_one();
+    }
+};
 
 
 /*
-*  Global variables
+*  Queue adapters
 */
 
-int   tbl[MAXITER * MAXTHREADS];
-int   nFinished = 0;
+// The queue bench drives every structure through one adapter:
+//   A(const benchconf &)   the structure, (1 << order) slots
+//   bool push(const P &)   false if full (no node free)
+//   bool pop(P &)          false if empty
+//   MPMC                   0: one producer, one consumer only
+//   MAXPAYLOAD             largest element it takes, bytes
+//   OVERCOMMIT             1: pop (push) may block on a ticket, the
+//                          adapter adds try_pop / try_push then
+// Unbounded structures are kept within BACKLOG elements by the
+// producers, not by the adapter.
+
+template <typename Q, typename P> struct queueadapter {
+    enum { MPMC = 1, MAXPAYLOAD = 1 << 30, OVERCOMMIT = 0 };
+
+    Q q;
+
+    queueadapter(const benchconf & c) : q(c.order) { ; }
+
+    inline bool push(const P & v) { return q.push(v); }
+    inline bool pop(P & v)        { return q.pop(v);  }
+};
+
+template <typename P> struct a_magicq : queueadapter<magicq<P>, P> {
+    enum { MPMC = 0 };
+    using queueadapter<magicq<P>, P>::queueadapter;
+};
+
+/* push / pop take a ticket first and wait for its slot, a stopped *
+ * run needs try_pop / try_push (never overcommit) to unblock them  */
+template <typename Q, typename P> struct rbqadapter : queueadapter<Q, P> {
+    enum { OVERCOMMIT = 1 };
+    using queueadapter<Q, P>::queueadapter;
+
+    inline bool try_push(const P & v) { return this->q.try_push(v); }
+    inline bool try_pop(P & v)        { return this->q.try_pop(v);  }
+};
+
+template <typename P> struct a_rbqueue : rbqadapter<rbqueue<P>, P> {
+    using rbqadapter<rbqueue<P>, P>::rbqadapter;
+};
+
+template <typename P> struct a_rbqueue_dense : rbqadapter<rbqueue<P, rbq_wait_sleep, rbq_layout_dense>, P> {
+    using rbqadapter<rbqueue<P, rbq_wait_sleep, rbq_layout_dense>, P>::rbqadapter;
+};
+
+template <typename P> struct a_rbqlist : queueadapter<rbqlist<P>, P> {
+    using queueadapter<rbqlist<P>, P>::queueadapter;
+};
+
+template <typename P> struct a_wfqueue : queueadapter<wfqueue<P>, P> {
+    enum { MAXPAYLOAD = 8 };
+    using queueadapter<wfqueue<P>, P>::queueadapter;
+};
+
+template <typename P> struct a_lfstack : queueadapter<lfstack_t<P>, P> {
+    using queueadapter<lfstack_t<P>, P>::queueadapter;
+};
+
+template <typename P> struct a_lffifo : queueadapter<lffifo_t<P>, P> {
+    using queueadapter<lffifo_t<P>, P>::queueadapter;
+};
+
+/* one lane per pushing thread */
+template <typename P> struct a_rbqlanes {
+    enum { MPMC = 1, MAXPAYLOAD = 1 << 30, OVERCOMMIT = 0 };
+
+    rbqlanes<P> q;
+
+    a_rbqlanes(const benchconf & c) : q(std::max(1, c.producers + c.hybrids), c.order) { ; }
+
+    inline bool push(const P & v) { return q.push(v); }
+    inline bool pop(P & v)        { return q.pop(v);  }
+};
+
+/* (1 << (order - 4)) nodes to begin with, growing up to (1 << order) */
+template <typename P> struct a_lfstack_grow {
+    enum { MPMC = 1, MAXPAYLOAD = 1 << 30, OVERCOMMIT = 0 };
+
+    lfstack_t<P> q;
+
+    a_lfstack_grow(const benchconf & c) : q(std::max(1, c.order - 4), c.order, 0) { ; }
+
+    inline bool push(const P & v) { return q.push(v); }
+    inline bool pop(P & v)        { return q.pop(v);  }
+};
+
+/* heap nodes, unbounded: (order) unused */
+template <typename Q, typename P> struct heapadapter {
+    enum { MPMC = 1, MAXPAYLOAD = 1 << 30, OVERCOMMIT = 0 };
+
+    Q q;
+
+    heapadapter(const benchconf &) { ; }
+
+    inline bool push(const P & v) { return q.push(v); }
+    inline bool pop(P & v)        { return q.pop(v);  }
+};
+
+template <typename P> struct a_lfstack_heap : heapadapter<lfstack_heap_t<P>, P> {
+    using heapadapter<lfstack_heap_t<P>, P>::heapadapter;
+};
+
+template <typename P> struct a_lffifo_heap : heapadapter<lffifo_heap_t<P>, P> {
+    using heapadapter<lffifo_heap_t<P>, P>::heapadapter;
+};
+
+template <typename P> struct a_lfstack_epoch : heapadapter<lfstack_heap_t<P, lf_epoch>, P> {
+    using heapadapter<lfstack_heap_t<P, lf_epoch>, P>::heapadapter;
+};
+
+template <typename P> struct a_lffifo_epoch : heapadapter<lffifo_heap_t<P, lf_epoch>, P> {
+    using heapadapter<lffifo_heap_t<P, lf_epoch>, P>::heapadapter;
+};
+
+/* random priorities, smallest first */
+template <typename P> struct a_lfprio {
+    enum { MPMC = 1, MAXPAYLOAD = 1 << 30, OVERCOMMIT = 0 };
+
+    lfprio_t<P> q;
+
+    a_lfprio(const benchconf & c) : q(c.order) { ; }
+
+    inline bool push(const P & v) { return q.push(benchkey(), v); }
+    inline bool pop(P & v)        { return q.pop(v);               }
+};
+
+template <typename P> struct a_mutexprio {
+    enum { MPMC = 1, MAXPAYLOAD = 1 << 30, OVERCOMMIT = 0 };
+
+    mutexprio<P> q;
+
+    a_mutexprio(const benchconf &) { ; }
+
+    inline bool push(const P & v) { return q.push(benchkey(), v); }
+    inline bool pop(P & v)        { return q.pop(v);               }
+};
+
+
+/*
+*  Queue bench
+*/
+
+/* per thread counters, read by the producers to bound the backlog */
+struct alignas(64) queuethread {
+    std::atomic<uint64_t> pushes;
+    std::atomic<uint64_t> pops;
+    uint64_t              sum;   /* xor of the values pushed and popped */
+};
+
+template <typename A, typename P> class queuebench {
+    A &                        q;
+    const benchconf &          c;
+    std::vector<queuethread> & ts;
+
+    inline uint64_t backlog()
+    {
+        uint64_t in = 0, out = 0;
+        for (auto & t : ts) {
+            in  += t.pushes.load(std::memory_order_relaxed);
+            out += t.pops.load(std::memory_order_relaxed);
+        }
+        return (in > out) ? in - out : 0;
+    }
+
+    /* false once stopped */
+    inline bool push(queuethread & t, uint64_t v)
+    {
+        P p(v);
+
+        latbegin();
+        while (!q.push(p)) {
+            if (stopped()) { return false; }
+        }
+        latend();
+
+        uint64_t n = t.pushes.load(std::memory_order_relaxed) + 1;
+        t.pushes.store(n, std::memory_order_relaxed);
+        t.sum ^= v;
+
+        /* unbounded structures: wait for the consumers now and then */
+        if ((n & 63) == 0) {
+            while ((backlog() > BACKLOG(c)) && !stopped()) { sched_yield(); }
+        }
+        return true;
+    }
+
+    inline bool pop(queuethread & t)
+    {
+        P p;
+
+        latbegin();
+        while (!q.pop(p)) {
+            if (stopped()) { return false; }
+        }
+        latend();
+
+        t.pops.store(t.pops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        t.sum ^= p.v;
+        return true;
+    }
+
+public:
+    queuebench(A & q_, const benchconf & c_, std::vector<queuethread> & ts_) : q(q_), c(c_), ts(ts_) { ; }
+
+    /* values are unique: the thread in the high bits */
+    void producer(int i)
+    {
+        queuethread & t = ts[i];
+        uint64_t      v = (uint64_t)(i + 1) << 40;
+
+        waitgo();
+        while (!stopped() && push(t, ++v)) { ; }
+        latmerge();
+    }
+
+    void consumer(int i)
+    {
+        queuethread & t = ts[i];
+
+        waitgo();
+        while (!stopped() && pop(t)) { ; }
+        latmerge();
+    }
+
+    void hybrid(int i)
+    {
+        queuethread & t = ts[i];
+        uint64_t      v = (uint64_t)(i + 1) << 40;
+        int           k;
 
-int64_t totSum = 0;
+        waitgo();
+        while (!stopped()) {
+            for (k = 0; (k < c.batch) && push(t, ++v); ++k) { ; }
+            for (k = 0; (k < c.batch) && pop(t); ++k) { ; }
+        }
+        latmerge();
+    }
+};
 
-static inline void recvi(int64_t d)
+template <typename A, typename P> bool queuerun(const benchconf & c, benchresult & r)
 {
-#ifdef _WIN32
-    InterlockedXor64(&totSum, (+d));
-    // InterlockedAdd64(&totSum, (+d));
-#else
-    // __sync_fetch_and_add(&totSum, (+d));
-    __sync_fetch_and_xor(&totSum, (+d));
-#endif
+    int n = c.producers + c.consumers + c.hybrids;
+    std::vector<queuethread> ts(n);
+    std::vector<std::thread> th;
+    std::atomic<int>         finished(0);
+    uint64_t                 drained = 0, fillers = 0, sum = 0;
+    P                        p, filler(0);
+
+    for (auto & t : ts) { t.pushes = 0; t.pops = 0; t.sum = 0; }
+
+    A q(c);
+    queuebench<A, P> b(q, c, ts);
+
+    runreset();
+    for (int i = 0; i < n; ++i) {
+        th.emplace_back([&, i] {
+            if (i < c.producers)                    { b.producer(i); }
+            else if (i < c.producers + c.consumers) { b.consumer(i); }
+            else                                    { b.hybrid(i);   }
+            finished.fetch_add(1);
+        });
+    }
+    r.seconds = runfor(c.seconds);
+
+    /* a push may wait for a pop that no consumer makes any more,   *
+     * an overcommitted pop for a push: zero fillers keep sum as is */
+    while (finished.load() < n) {
+        if constexpr (A::OVERCOMMIT) {
+            while (q.try_pop(p)) { sum ^= p.v; ++drained; }
+            if (q.try_push(filler)) { ++fillers; }
+        }
+        else if (A::MPMC) {
+            while (q.pop(p)) { sum ^= p.v; ++drained; }
+        }
+        sched_yield();
+    }
+    for (auto & t : th) { t.join(); }
+    if constexpr (A::OVERCOMMIT) { while (q.try_pop(p)) { sum ^= p.v; ++drained; } }
+    else                         { while (q.pop(p))     { sum ^= p.v; ++drained; } }
+
+    uint64_t pushes = 0, pops = 0;
+    for (auto & t : ts) {
+        pushes += t.pushes.load();
+        pops   += t.pops.load();
+        sum    ^= t.sum;
+    }
+
+    r.ops    = pushes + pops;
+    r.active = n;
+    r.ok     = (sum == 0) && (pushes + fillers == pops + drained);
+    latreport(r.lat);
+    return true;
 }
 
-static inline void posti(int64_t d)
+/* one element size, within the adapter's MAXPAYLOAD at compile time */
+template <template <typename> class A, int N> bool queuesized(const benchconf & c, benchresult & r, const char ** why)
 {
-#ifdef _WIN32
-    InterlockedXor64(&totSum, (+d));
-    // InterlockedAdd64(&totSum, (-d));
-#else
-    // __sync_fetch_and_sub(&totSum, (+d));
-    __sync_fetch_and_xor(&totSum, (+d));
-#endif
+    if constexpr (N > (int)A<payload<8>>::MAXPAYLOAD) {
+        (void)c; (void)r;
+        *why = "payload too large for it";
+        return false;
+    }
+    else {
+        if (!A<payload<N>>::MPMC && ((c.producers != 1) || (c.consumers != 1) || (c.hybrids != 0))) {
+            *why = "single producer single consumer only (-p 1 -c 1 -m 0)";
+            return false;
+        }
+        return queuerun<A<payload<N>>, payload<N>>(c, r);
+    }
 }
 
-// init stack with cells
-void initstack(pile* f)
+template <template <typename> class A> bool queuebench_run(const benchconf & c, benchresult & r, const char ** why)
 {
-    INIT(f);
+    if ((c.producers + c.hybrids == 0) || (c.consumers + c.hybrids == 0)) {
+        *why = "needs a thread that pushes and one that pops";
+        return false;
+    }
+
+    switch (c.payload) {
+    case 8:   return queuesized<A, 8>(c, r, why);
+    case 16:  return queuesized<A, 16>(c, r, why);
+    case 64:  return queuesized<A, 64>(c, r, why);
+    case 256: return queuesized<A, 256>(c, r, why);
+    }
+    *why = "payload is 8, 16, 64 or 256 bytes";
+    return false;
 }
 
-long hybrid(long n)
+
+/*
+*  Hash bench
+*/
+
+struct alignas(64) hashthread {
+    uint64_t ops;
+    uint64_t bad;   /* a get that found another key's value */
+};
+
+/* keys in [1, keys], about half of them present, the table at most 1/4 full */
+template <typename H> bool hashrun(const benchconf & c, benchresult & r, const char ** why)
 {
-    int64_t r;
-    int i; clock_t t;
+    if (c.threads < 1) { *why = "needs a thread (-t)"; return false; }
 
-    t = clock();
-    while (n--) {
-        for (i = 0; i < MAXITER; i++)
-        {
-            // int64_t t2 = (n + 2);
-            time_t t2 = time(NULL);
-            // clock_t t2 = clock();
-            // int64_t t2 = rand();
-            while (!PUSH(&gstack, (void*)(t2)));
-            posti(t2);
-        }
-        for (i = 0; i < MAXITER; i++) {
-            while (!(r = (int64_t)(POP(&gstack))));
-            recvi(r);
-        }
+    uint64_t keys = (c.order > 2) ? (1ULL << (c.order - 2)) : 1;
+    std::vector<hashthread>  ts(c.threads);
+    std::vector<std::thread> th;
+
+    H h(c.order);
+    for (uint64_t k = 1; k <= keys; k += 2) { h.put(k, k); }
+
+    runreset();
+    for (int i = 0; i < c.threads; ++i) {
+        th.emplace_back([&, i] {
+            hashthread & t = ts[i];
+            uint32_t seed = (uint32_t)(i + 1) * 0x9E3779B9u;
+            uint64_t val;
+
+            t.ops = 0; t.bad = 0;
+            waitgo();
+            while (!stopped()) {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+
+                uint64_t key = 1 + (seed >> 8) % keys;
+                latbegin();
+                if ((int)(seed % 100) < c.reads) {
+                    if (h.get(key, val) && (val != key)) { t.bad++; }
+                }
+                else if (t.ops & 1) {
+                    h.put(key, key);
+                }
+                else {
+                    h.erase(key);
+                }
+                latend();
+                t.ops++;
+            }
+            latmerge();
+        });
     }
-    return clock() - t;
+    r.seconds = runfor(c.seconds);
+    for (auto & t : th) { t.join(); }
+
+    r.ops    = 0;
+    r.ok     = (h.getsize() <= keys);
+    r.active = c.threads;
+    for (auto & t : ts) { r.ops += t.ops; r.ok = r.ok && (t.bad == 0); }
+    latreport(r.lat);
+    return true;
 }
 
-long producer(long n)
+
+/*
+*  Steal bench
+*/
+
+/* the owner pushes and pops at one end, thieves take from the other */
+struct s_wsdeque {
+    wsdeque<uint64_t> q;
+
+    s_wsdeque(const benchconf & c) : q(c.order) { ; }
+
+    inline bool push(uint64_t v)    { q.push(v); return true; }
+    inline bool pop(uint64_t & v)   { return q.pop(v);        }
+    inline bool steal(uint64_t & v) { return q.steal(v);      }
+};
+
+/* the same load on one lock free stack */
+struct s_lfstack {
+    lfstack_t<uint64_t> q;
+
+    s_lfstack(const benchconf & c) : q(c.order) { ; }
+
+    inline bool push(uint64_t v)    { return q.push(v); }
+    inline bool pop(uint64_t & v)   { return q.pop(v);  }
+    inline bool steal(uint64_t & v) { return q.pop(v);  }
+};
+
+template <typename S> bool stealrun(const benchconf & c, benchresult & r, const char ** why)
 {
-    clock_t t;
-    n = n * MAXITER;
-
-    t = clock();
-    while (n--) {
-        // int64_t t2 = (n + 2);
-        time_t t2 = time(NULL);
-        // clock_t t2 = clock();
-        // int64_t t2 = rand();
-        while (!PUSH(&gstack, (void*)(t2)));
-        posti(t2);
-    }
-    return clock() - t;
+    if (c.threads < 1) { *why = "needs an owner thread (-t)"; return false; }
+
+    std::vector<queuethread> ts(c.threads);
+    std::vector<std::thread> th;
+    uint64_t                 drained = 0, sum = 0, v;
+
+    for (auto & t : ts) { t.pushes = 0; t.pops = 0; t.sum = 0; }
+
+    S q(c);
+
+    runreset();
+    th.emplace_back([&] {
+        queuethread & t = ts[0];
+        uint64_t      x, n = 1ULL << 40;
+        int           k;
+
+        waitgo();
+        while (!stopped()) {
+            for (k = 0; k < c.batch; ++k) {
+                bool in;
+                latbegin();
+                while (!(in = q.push(n + 1)) && !stopped()) { ; }
+                if (!in) { break; }
+                latend();
+                t.pushes.store(t.pushes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                t.sum ^= ++n;
+            }
+            for (k = 0; k < c.batch; ++k) {
+                latbegin();
+                if (!q.pop(x)) { continue; }
+                latend();
+                t.pops.store(t.pops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                t.sum ^= x;
+            }
+        }
+        latmerge();
+    });
+    for (int i = 1; i < c.threads; ++i) {
+        th.emplace_back([&, i] {
+            queuethread & t = ts[i];
+            uint64_t      x;
+
+            waitgo();
+            while (!stopped()) {
+                if (q.steal(x)) {
+                    t.pops.store(t.pops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    t.sum ^= x;
+                }
+            }
+        });
+    }
+    r.seconds = runfor(c.seconds);
+    for (auto & t : th) { t.join(); }
+
+    /* every thread is gone, the owner's end is ours */
+    while (q.pop(v)) { sum ^= v; ++drained; }
+
+    uint64_t pushes = 0, pops = 0;
+    for (auto & t : ts) {
+        pushes += t.pushes.load();
+        pops   += t.pops.load();
+        sum    ^= t.sum;
+    }
+
+    r.ops    = pushes + pops;
+    r.active = c.threads;
+    r.ok     = (sum == 0) && (pushes == pops + drained);
+    latreport(r.lat);
+    return true;
 }
 
-long consumer(long n)
+
+/*
+*  Pool bench
+*/
+
+struct pooltask : lftask_t {
+    std::atomic<long> *     done;
+    std::atomic<uint64_t> * sum;
+    uint64_t                v;
+
+    void run() override {
+        sum->fetch_xor(v, std::memory_order_relaxed);
+        done->fetch_add(1, std::memory_order_release);
+    }
+};
+
+/* task i submits 2i + 1 and 2i + 2 from the worker running it */
+template <typename X> struct pooltree : pooltask {
+    X *        pool;
+    pooltree * tree;
+    long       i, n;
+
+    void run() override {
+        if (2 * i + 1 < n) { pool->submit(&tree[2 * i + 1]); }
+        if (2 * i + 2 < n) { pool->submit(&tree[2 * i + 2]); }
+        pooltask::run();
+    }
+};
+
+/* throughput: waves of (1 << order) tasks until the duration elapsed, *
+ * every wave is timed like a fan-out round;                           *
+ * SPAWN: the main thread submits the root of a binary tree and every  *
+ * task submits its children (worker deques, stealing), else the main *
+ * thread submits every task (injection queue)                        */
+template <typename X, bool SPAWN> bool poolwaves(const benchconf & c, benchresult & r, const char ** why)
 {
-    clock_t t;
-    n = n * MAXITER;
+    if (c.threads < 1) { *why = "needs a worker (-t)"; return false; }
+
+    long                        n = 1L << c.order;
+    std::atomic<long>           done(0);
+    std::atomic<uint64_t>       sum(0);
+    std::vector<pooltree<X>>    tasks(n);
+    uint64_t                    posted = 0, v = 0, waves = 0;
 
-    int64_t r;
+    X pool(c.threads, c.order);
 
-    t = clock();
-    while (n--) {
-        while (!(r = (int64_t)POP(&gstack)));
-        recvi(r);
+    for (long i = 0; i < n; ++i) {
+        tasks[i].done = &done; tasks[i].sum = &sum;
+        tasks[i].pool = &pool; tasks[i].tree = tasks.data(); tasks[i].i = i; tasks[i].n = SPAWN ? n : 0;
     }
-    return clock() - t;
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto t1 = t0;
+    do {
+        for (auto & t : tasks) { t.v = ++v; posted ^= v; }
+        done.store(0);
+
+        auto ts = std::chrono::steady_clock::now();
+        if (SPAWN) { pool.submit(&tasks[0]); }
+        else       { for (auto & t : tasks) { pool.submit(&t); } }
+        while (done.load(std::memory_order_acquire) < n) { sched_yield(); }
+        t1 = std::chrono::steady_clock::now();
+
+        latrecord((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - ts).count());
+        ++waves;
+    } while (std::chrono::duration<double>(t1 - t0).count() < c.seconds);
+    latmerge();
+
+    r.seconds = std::chrono::duration<double>(t1 - t0).count();
+    r.ops     = waves * n;
+    r.active  = c.threads;
+    r.ok      = (sum.load() == posted);
+    latreport(r.lat);
+    return true;
 }
 
-THRRET hybridthread(void* pp)
+/* latency: the main thread submits FANOUT tasks and waits for all of them, *
+ * every round is timed; an op is a round, ns/op the mean round latency    */
+template <typename X> bool poolrun(const benchconf & c, benchresult & r, const char ** why)
 {
-    pont* p = (pont*)pp;
-    p->duration = hybrid(p->limit);
-    p->stopped = 1;
-    return 0;
+    if (c.threads < 1) { *why = "needs a worker (-t)"; return false; }
+
+    std::atomic<long>     done(0);
+    std::atomic<uint64_t> sum(0);
+    std::vector<pooltask> tasks(FANOUT);
+    uint64_t              posted = 0, v = 0, rounds = 0;
+
+    for (auto & t : tasks) { t.done = &done; t.sum = &sum; }
+
+    X pool(c.threads, c.order);
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto t1 = t0;
+    do {
+        for (auto & t : tasks) { t.v = ++v; posted ^= v; }
+        done.store(0);
+
+        auto ts = std::chrono::steady_clock::now();
+        for (auto & t : tasks) { pool.submit(&t); }
+        while (done.load(std::memory_order_acquire) < FANOUT) { sched_yield(); }
+        t1 = std::chrono::steady_clock::now();
+
+        latrecord((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - ts).count());
+        ++rounds;
+    } while (std::chrono::duration<double>(t1 - t0).count() < c.seconds);
+    latmerge();
+
+    r.seconds = std::chrono::duration<double>(t1 - t0).count();
+    r.ops     = rounds;
+    r.active  = 1;
+    r.ok      = (sum.load() == posted);
+    latreport(r.lat);
+    return true;
 }
 
-THRRET producerthread(void* pp)
+
+/*
+*  Structures
+*/
+
+typedef bool (*benchfn)(const benchconf &, benchresult &, const char **);
+
+typedef struct benchentry {
+    const char * name;
+    const char * kind;
+    benchfn      run;
+    const char * about;
+} benchentry;
+
+static const benchentry benches[] = {
+    { "magicq",            "queue", queuebench_run<a_magicq>,        "SPSC ring (magicq.hpp)" },
+    { "rbqueue",           "queue", queuebench_run<a_rbqueue>,       "MPMC ring, one line per slot (rbq.hpp)" },
+    { "rbqueue-dense",     "queue", queuebench_run<a_rbqueue_dense>, "MPMC ring, rbq_layout_dense slots (rbq.hpp)" },
+    { "rbqlanes",          "queue", queuebench_run<a_rbqlanes>,      "MPMC rings, one lane per pushing thread (rbqlanes.hpp)" },
+    { "rbqlist",           "queue", queuebench_run<a_rbqlist>,       "unbounded MPMC queue, linked ring segments (rbqlist.hpp)" },
+    { "wfqueue",           "queue", queuebench_run<a_wfqueue>,       "wait-free bounded MPMC queue, 8 byte elements (wfqueue.hpp)" },
+    { "lfstack",           "queue", queuebench_run<a_lfstack>,       "lock free stack, node array (lffifo.hpp)" },
+    { "lfstack-grow",      "queue", queuebench_run<a_lfstack_grow>,  "lock free stack, 1 << (order - 4) nodes growing (lffifo.hpp)" },
+    { "lffifo",            "queue", queuebench_run<a_lffifo>,        "lock free fifo, MS queue on a node array (lffifo.hpp)" },
+    { "lfstack-heap",      "queue", queuebench_run<a_lfstack_heap>,  "lock free stack, heap nodes, hazard pointers (lfheap.hpp)" },
+    { "lffifo-heap",       "queue", queuebench_run<a_lffifo_heap>,   "lock free fifo, heap nodes, hazard pointers (lfheap.hpp)" },
+    { "lfstack-epoch",     "queue", queuebench_run<a_lfstack_epoch>, "lock free stack, heap nodes, epochs (lfheap.hpp)" },
+    { "lffifo-epoch",      "queue", queuebench_run<a_lffifo_epoch>,  "lock free fifo, heap nodes, epochs (lfheap.hpp)" },
+    { "lfprio",            "queue", queuebench_run<a_lfprio>,        "lock free priority queue, random keys (lfprio.hpp)" },
+    { "mutexprio",         "queue", queuebench_run<a_mutexprio>,     "std::priority_queue under a mutex, random keys" },
+    { "lfhash",            "hash",  hashrun<lfhash_t>,               "lock free hash map (lfhash.hpp)" },
+    { "mutexhash",         "hash",  hashrun<mutexhash>,              "std::unordered_map under a mutex" },
+    { "wsdeque",           "steal", stealrun<s_wsdeque>,             "work-stealing deque (wsdeque.hpp)" },
+    { "lfstack-steal",     "steal", stealrun<s_lfstack>,             "lock free stack under the wsdeque load" },
+    { "lfexecutor-inject", "pool",  poolwaves<lfexecutor_t, false>,  "work-stealing thread pool, tasks from outside (lfexec.hpp)" },
+    { "lfexecutor-spawn",  "pool",  poolwaves<lfexecutor_t, true>,   "work-stealing thread pool, tasks spawning tasks (lfexec.hpp)" },
+    { "lfexecutor-fanout", "pool",  poolrun<lfexecutor_t>,           "work-stealing thread pool, rounds of 64 tasks, ops are rounds" },
+    { "mutexpool-inject",  "pool",  poolwaves<mutexpool, false>,     "std::deque + mutex + condition_variable pool, tasks from outside" },
+    { "mutexpool-spawn",   "pool",  poolwaves<mutexpool, true>,      "std::deque + mutex + condition_variable pool, tasks spawning tasks" },
+    { "mutexpool-fanout",  "pool",  poolrun<mutexpool>,              "std::deque + mutex + condition_variable pool, rounds of 64 tasks" },
+};
+
+#define NBENCHES     ((int)(sizeof(benches) / sizeof(benches[0])))
+
+
+/*
+*  Command line
+*/
+
+enum { FMT_TEXT, FMT_CSV, FMT_JSON };
+
+static void usage(FILE * f)
 {
-    pont* p = (pont*)pp;
-    p->duration = producer(p->limit);
-    p->stopped = 1;
-    return 0;
+    fprintf(f,
+        "usage: ffbench [options]\n"
+        "  -s, --struct LIST     structures, kinds (queue hash steal pool) or all; default rbqueue\n"
+        "  -p, --producers LIST  queue: threads that push (default 1)\n"
+        "  -c, --consumers LIST  queue: threads that pop (default 1)\n"
+        "  -m, --hybrids LIST    queue: threads that push a batch, then pop a batch (default 0)\n"
+        "  -t, --threads LIST    hash / steal / pool: threads (default 2)\n"
+        "  -b, --payload LIST    queue: element bytes, 8 16 64 or 256 (default 8)\n"
+        "  -o, --order N         1 << N slots / nodes (default 12)\n"
+        "  -k, --batch N         hybrid and steal owner batch (default 8)\n"
+        "  -r, --reads LIST      hash: %% of gets, the rest put / erase (default 90)\n"
+        "  -d, --duration SEC    seconds per run (default 1)\n"
+        "  -l, --latency         p50/p99/p99.9/max ns of every operation\n"
+        "  -f, --format FMT      text, csv or json (one object per line); default text\n"
+        "      --no-header       csv without the header line\n"
+        "  -L, --list            list the structures\n"
+        "  -h, --help\n"
+        "LIST is comma separated, every combination runs. Exit status 1 if a run lost or\n"
+        "duplicated an element, 2 on a usage error.\n");
 }
 
-THRRET consumerthread(void* pp)
+static void list()
 {
-    pont* p = (pont*)pp;
-    p->duration = consumer(p->limit);
-    p->stopped = 1;
-    return 0;
+    for (int i = 0; i < NBENCHES; ++i) {
+        printf("%-17s %-6s %s\n", benches[i].name, benches[i].kind, benches[i].about);
+    }
 }
 
-//-----------------------------------------------------------------
-void bench(int max)
+static std::vector<std::string> split(const char * s)
 {
-#ifdef _WIN32
-    DWORD fils[MAXTHREADS];
-#else
-    pthread_t fils[MAXTHREADS];
-#endif
+    std::vector<std::string> out;
+    std::string cur;
 
-    pont  bridge_p[MAXTHREADS];
-    pont  bridge_c[MAXTHREADS];
-    pont  bridge_h[MAXTHREADS];
+    for (; *s; ++s) {
+        if (*s == ',') { if (!cur.empty()) { out.push_back(cur); } cur.clear(); }
+        else { cur += *s; }
+    }
+    if (!cur.empty()) { out.push_back(cur); }
+    return out;
+}
 
-    long   i, end, th;
-    double perf = 0;
+/* comma separated integers in [lo, hi] */
+static bool intlist(const char * s, int lo, int hi, std::vector<int> & out)
+{
+    out.clear();
+    for (auto & item : split(s)) {
+        char * end;
+        long   n = strtol(item.c_str(), &end, 10);
+        if ((*end != 0) || (n < lo) || (n > hi)) { return false; }
+        out.push_back((int)n);
+    }
+    return !out.empty();
+}
 
-    for (th = 1; th <= max; ++th)
-    {
-        srand(time(NULL));
+static void report(int fmt, const benchentry & e, const benchconf & c, const benchresult & r)
+{
+    double mops = (r.seconds > 0) ? (double)r.ops / r.seconds / 1e6 : 0;
+    double nsop = (r.ops > 0) ? r.seconds * 1e9 * r.active / (double)r.ops : 0;
 
-        initstack(&gstack);
-        totSum = 0;
-        printf("threads count:\t %ld \t", th); fflush(stdout);
-        for (i = 0; i < th; i++)
-        {
-            bridge_p[i].limit = LIMIT;
-            bridge_p[i].stopped = 0;
-            bridge_p[i].duration = 0;
-
-            bridge_c[i].limit = LIMIT;
-            bridge_c[i].stopped = 0;
-            bridge_c[i].duration = 0;
-
-            bridge_h[i].limit = LIMIT;
-            bridge_h[i].stopped = (TESTMODE == 0) ? 1 : 0;
-            bridge_h[i].duration = 0;
-
-#ifdef _WIN32         
-            CreateThread(
-                NULL,
-                0L,
-                producerthread,
-                &bridge_p[i],
-                0L,
-                &(fils[i])
-            );
-
-            CreateThread(
-                NULL,
-                0L,
-                consumerthread,
-                &bridge_c[i],
-                0L,
-                &(fils[i])
-            );
-
-#if (TESTMODE != 0)
-            CreateThread(
-                NULL,
-                0L,
-                hybridthread,
-                &bridge_h[i],
-                0L,
-                &(fils[i])
-            );
-#endif
-#else
-            pthread_create(
-                &fils[i],
-                NULL,
-                producerthread,
-                &bridge_p[i]
-            );
-
-            pthread_create(
-                &fils[i],
-                NULL,
-                consumerthread,
-                &bridge_c[i]
-            );
-
-#if (TESTMODE != 0)
-            pthread_create(
-                &fils[i],
-                NULL,
-                hybridthread,
-                &bridge_h[i]
-            );
-#endif
-#endif
+    switch (fmt) {
+    case FMT_CSV:
+        printf("%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%llu,%.4f,%.2f,%d,%llu,%llu,%llu,%llu\n",
+            e.name, e.kind, c.producers, c.consumers, c.hybrids, c.threads, c.order, c.payload, c.batch, c.reads,
+            r.seconds, (unsigned long long)r.ops, mops, nsop, r.ok ? 1 : 0,
+            (unsigned long long)r.lat[0], (unsigned long long)r.lat[1], (unsigned long long)r.lat[2], (unsigned long long)r.lat[3]);
+        break;
+
+    case FMT_JSON:
+        printf("{\"structure\":\"%s\",\"kind\":\"%s\",\"producers\":%d,\"consumers\":%d,\"hybrids\":%d,\"threads\":%d,"
+            "\"order\":%d,\"payload\":%d,\"batch\":%d,\"reads\":%d,\"seconds\":%.3f,\"ops\":%llu,\"mops\":%.4f,\"ns_per_op\":%.2f,\"ok\":%s,"
+            "\"lat_ns\":{\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}}\n",
+            e.name, e.kind, c.producers, c.consumers, c.hybrids, c.threads, c.order, c.payload, c.batch, c.reads,
+            r.seconds, (unsigned long long)r.ops, mops, nsop, r.ok ? "true" : "false",
+            (unsigned long long)r.lat[0], (unsigned long long)r.lat[1], (unsigned long long)r.lat[2], (unsigned long long)r.lat[3]);
+        break;
+
+    default:
+        if (strcmp(e.kind, "queue") == 0) {
+            printf("%-17s p %2d c %2d m %2d payload %3d:", e.name, c.producers, c.consumers, c.hybrids, c.payload);
+        } else if (strcmp(e.kind, "hash") == 0) {
+            printf("%-17s threads %2d reads %3d%%   :", e.name, c.threads, c.reads);
+        } else {
+            printf("%-17s threads %2d %13s:", e.name, c.threads, "");
+        }
+        printf(" %9.3f Mops/s %9.1f ns/op %s", mops, nsop, r.ok ? "ok" : "LOST/DUPLICATED");
+        if (latency || (r.lat[3] != 0)) {
+            printf("  latency (ns) p50/p99/p99.9/max: %llu %llu %llu %llu",
+                (unsigned long long)r.lat[0], (unsigned long long)r.lat[1], (unsigned long long)r.lat[2], (unsigned long long)r.lat[3]);
         }
+        printf("\n");
+        break;
+    }
+    fflush(stdout);
+}
 
-        nFinished = 0;
-        do {
-            sleep(1);
-            end = 1;
-            int nn = 0;
-            for (i = 0; i < th; i++) {
-                end &= bridge_p[i].stopped;
-                end &= bridge_c[i].stopped;
-                end &= bridge_h[i].stopped;
-
-                nn += (bridge_p[i].stopped ? (1) : (0));
-                nn += (bridge_c[i].stopped ? (1) : (0));
-                nn += (bridge_h[i].stopped ? (1) : (0));
-            }
-            if (nFinished != nn)
-            {
-                // printf("%d tasks finished.\n", nn);
-                nFinished = nn;
+int main(int argc, char ** argv)
+{
+    std::vector<std::string> structs = { "rbqueue" };
+    std::vector<int> producers = { 1 }, consumers = { 1 }, hybrids = { 0 }, threads = { 2 }, payloads = { 8 }, reads = { 90 };
+    benchconf base = { 0, 0, 0, 0, 12, 8, 8, 90, 1.0 };
+    int  fmt = FMT_TEXT;
+    bool header = true;
 
-                // if (nFinished >= ((MAXTHREADS * 3) - 1))
-                // {
-                //    printf("remain data in queue = %d\n", SIZE(&gstack));
-                // }
-            }
-        } while (end == 0);
+    for (int i = 1; i < argc; ++i) {
+        std::string opt = argv[i], val;
+        bool        inline_val = false;
+        size_t      eq;
 
-        for (i = 0; i < th; i++) {
-            perf += bridge_p[i].duration;
+        if ((opt.compare(0, 2, "--") == 0) && ((eq = opt.find('=')) != std::string::npos)) {
+            val = opt.substr(eq + 1); opt = opt.substr(0, eq); inline_val = true;
         }
-        perf /= th;
 
-        perf /= th * LIMIT * MAXITER;
-        perf *= 1000000 / CLOCKS_PER_SEC;
-        printf(" totSum = %ld, perf (in us per pop/push):\t %2f\n", totSum, perf); fflush(stdout);
+        /* the value of an option: --opt=value, or the next argument */
+        auto value = [&]() -> const char * {
+            if (inline_val) { return val.c_str(); }
+            if (i + 1 < argc) { return argv[++i]; }
+            fprintf(stderr, "ffbench: %s needs a value\n", opt.c_str());
+            exit(2);
+        };
+        auto bad = [&](const char * v) {
+            fprintf(stderr, "ffbench: bad value '%s' for %s\n", v, opt.c_str());
+            exit(2);
+        };
 
-        FREE(&gstack);
+        if      ((opt == "-h") || (opt == "--help"))      { usage(stdout); return 0; }
+        else if ((opt == "-L") || (opt == "--list"))      { list(); return 0; }
+        else if ((opt == "-l") || (opt == "--latency"))   { latency = true; }
+        else if (opt == "--no-header")                    { header = false; }
+        else if ((opt == "-s") || (opt == "--struct"))    { structs = split(value()); }
+        else if ((opt == "-p") || (opt == "--producers")) { const char * v = value(); if (!intlist(v, 0, LF_MAXTHREADS, producers)) { bad(v); } }
+        else if ((opt == "-c") || (opt == "--consumers")) { const char * v = value(); if (!intlist(v, 0, LF_MAXTHREADS, consumers)) { bad(v); } }
+        else if ((opt == "-m") || (opt == "--hybrids"))   { const char * v = value(); if (!intlist(v, 0, LF_MAXTHREADS, hybrids))   { bad(v); } }
+        else if ((opt == "-t") || (opt == "--threads"))   { const char * v = value(); if (!intlist(v, 1, LF_MAXTHREADS, threads))   { bad(v); } }
+        else if ((opt == "-b") || (opt == "--payload"))   { const char * v = value(); if (!intlist(v, 8, 256, payloads))           { bad(v); } }
+        else if ((opt == "-r") || (opt == "--reads"))     { const char * v = value(); if (!intlist(v, 0, 100, reads))              { bad(v); } }
+        else if ((opt == "-o") || (opt == "--order")) {
+            std::vector<int> n; const char * v = value();
+            if (!intlist(v, 1, 30, n) || (n.size() != 1)) { bad(v); }
+            base.order = n[0];
+        }
+        else if ((opt == "-k") || (opt == "--batch")) {
+            std::vector<int> n; const char * v = value();
+            if (!intlist(v, 1, 1 << 20, n) || (n.size() != 1)) { bad(v); }
+            base.batch = n[0];
+        }
+        else if ((opt == "-d") || (opt == "--duration")) {
+            const char * v = value(); char * end;
+            base.seconds = strtod(v, &end);
+            if ((*end != 0) || !(base.seconds > 0)) { bad(v); }
+        }
+        else if ((opt == "-f") || (opt == "--format")) {
+            std::string v = value();
+            if      (v == "text") { fmt = FMT_TEXT; }
+            else if (v == "csv")  { fmt = FMT_CSV;  }
+            else if (v == "json") { fmt = FMT_JSON; }
+            else { bad(v.c_str()); }
+        }
+        else {
+            fprintf(stderr, "ffbench: unknown option %s\n", opt.c_str());
+            usage(stderr);
+            return 2;
+        }
     }
-}
 
-int main()
-{
-    // mmFixedSizeMemoryStartup();
-
-#if (TESTMODE == 0)
-    printf("\n-------- Lock free ring buffer (SPSC) bench ----------\n");
-#elif (TESTMODE == 1)
-    printf("\n-------- Lock free ring buffer (MPMC) bench ----------\n");
-#elif (TESTMODE == 2)
-    printf("\n-------- Lock free stack bench ----------\n");
-#elif (TESTMODE == 3)
-    printf("\n-------- Lock free queue (MSQ) bench ----------\n");
-#endif
+    /* structure names, kinds and "all" to entries */
+    std::vector<const benchentry *> runs;
+    for (auto & s : structs) {
+        bool found = false;
+        for (int i = 0; i < NBENCHES; ++i) {
+            if ((s == "all") || (s == benches[i].name) || (s == benches[i].kind)) {
+                runs.push_back(&benches[i]);
+                found = true;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "ffbench: unknown structure %s (ffbench -L lists them)\n", s.c_str());
+            return 2;
+        }
+    }
 
-    bench((TESTMODE == 0) ? (1) : MAXTHREADS);
+    if ((fmt == FMT_CSV) && header) {
+        printf("structure,kind,producers,consumers,hybrids,threads,order,payload,batch,reads,seconds,ops,mops,ns_per_op,ok,p50_ns,p99_ns,p999_ns,max_ns\n");
+    }
 
-    // mmFixedSizeMemoryCleanup();
+    int failed = 0;
+    for (const benchentry * e : runs) {
+        bool queue = (strcmp(e->kind, "queue") == 0);
+        bool hash  = (strcmp(e->kind, "hash") == 0);
 
-    return 0;
-}
+        /* the lists a kind does not use collapse to one zero */
+        std::vector<int> bs = queue ? payloads  : std::vector<int>{ 8 };
+        std::vector<int> ps = queue ? producers : std::vector<int>{ 0 };
+        std::vector<int> cs = queue ? consumers : std::vector<int>{ 0 };
+        std::vector<int> ms = queue ? hybrids   : std::vector<int>{ 0 };
+        std::vector<int> ts = queue ? std::vector<int>{ 0 } : threads;
+        std::vector<int> rs = hash  ? reads     : std::vector<int>{ 0 };
+
+        for (int b : bs) for (int p : ps) for (int c : cs) for (int m : ms) for (int t : ts) for (int rd : rs) {
+            benchconf   conf = base;
+            benchresult r;
+            const char * why = "";
+
+            conf.payload = b; conf.producers = p; conf.consumers = c; conf.hybrids = m; conf.threads = t; conf.reads = rd;
+            memset(&r, 0, sizeof(r));
+            if (!e->run(conf, r, &why)) {
+                fprintf(stderr, "ffbench: %s p %d c %d m %d t %d payload %d reads %d skipped: %s\n", e->name, p, c, m, t, b, rd, why);
+                continue;
+            }
+            report(fmt, *e, conf, r);
+            if (!r.ok) { ++failed; }
+        }
+    }
+    return failed ? 1 : 0;
+}
\ No newline at end of file
@@ -1,4 +1,10 @@
 #include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "lfmem.hpp"
+#include "lfthread.hpp"
 
 #ifndef __LOCKFREE_RBQ_MPMC_H__
 #define __LOCKFREE_RBQ_MPMC_H__
@@ -37,40 +43,235 @@ extern "C" {
 #include <sched.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 #endif  // _WIN32
 
-constexpr uint32_t STATUS_EMPT = 0;
-constexpr uint32_t STATUS_FILL = 1;
-constexpr uint32_t STATUS_READ = 2;
-constexpr uint32_t STATUS_FULL = 3;
+//////////////////////////////////////////////////////////////
+/* wait policies used while a slot is owned by a slow peer  */
+//////////////////////////////////////////////////////////////
+// wait() is called with the sequence value seen in the slot,
+// wake() is called by the peer right after it changed the sequence.
+
+/* timer sleep of 1~2us (~50us on linux), cheapest on CPU */
+struct rbq_wait_sleep
+{
+	inline void wait(std::atomic<uint32_t> &, uint32_t, uint64_t index, uint32_t) {
+		usleep((index & 1) + 1);
+	};
+	inline void wake(std::atomic<uint32_t> &) { ; };
+};
+
+/* busy spin with pause, lowest latency, burns a core */
+struct rbq_wait_spin
+{
+	inline void wait(std::atomic<uint32_t> &, uint32_t, uint64_t, uint32_t) {
+		cpu_relax();
+	};
+	inline void wake(std::atomic<uint32_t> &) { ; };
+};
+
+/* spin (SPINS) rounds, then give up the time slice */
+template <uint32_t SPINS = 64> struct rbq_wait_yield
+{
+	inline void wait(std::atomic<uint32_t> &, uint32_t, uint64_t, uint32_t spins) {
+		if (spins < SPINS) { cpu_relax(); } else { sched_yield(); }
+	};
+	inline void wake(std::atomic<uint32_t> &) { ; };
+};
 
-template <typename T> class rbqueue
+/* spin (SPINS) rounds, then park on the slot sequence(futex),*
+ * the completing side wakes the slot only if anyone parked.  */
+template <uint32_t SPINS = 64> struct rbq_wait_park
+{
+	alignas(64) std::atomic<uint32_t> sleepers;
+
+	rbq_wait_park() : sleepers(0) { ; };
+
+	inline void wait(std::atomic<uint32_t> & seq, uint32_t seen, uint64_t, uint32_t spins) {
+		if (spins < SPINS) { cpu_relax(); return; }
+
+		sleepers.fetch_add(1);
+#ifdef __linux__
+		syscall(SYS_futex, (uint32_t *)(&seq), FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+#else
+		sched_yield();
+#endif
+		sleepers.fetch_sub(1);
+	};
+
+	inline void wake(std::atomic<uint32_t> & seq) {
+		/* pairs with fetch_add in wait(): either we see the sleeper, *
+		 * or the sleeper sees the new sequence in FUTEX_WAIT.       */
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleepers.load(std::memory_order_relaxed) == 0) { return; }
+#ifdef __linux__
+		syscall(SYS_futex, (uint32_t *)(&seq), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+	};
+};
+//////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+/* slot layouts, rbqueue<T, W, L> takes one as L            */
+//////////////////////////////////////////////////////////////
+// A layout maps a ticket to a slot and gives the sequence
+// and the raw object storage of a slot:
+//   static size_t bytes(size)    memory needed for (size) slots
+//   void   attach(mem, size)     lay the slots out in (mem)
+//   size_t slot(ticket)          slot of a ticket
+//   seq(slot) / object(slot)
+//////////////////////////////////////////////////////////////
+
+/* one 64-byte line per slot {seq, object}: no false sharing at all, *
+ * but 64 bytes (or more) per slot whatever the size of T            */
+template <typename T> class rbq_layout_padded
 {
 	struct alignas(64) rbnode
 	{
-		std::atomic<uint32_t> status; T object;
-		rbnode() { status.store(STATUS_EMPT); };
+		std::atomic<uint32_t> seq;
+
+		/* raw storage, the object is constructed on push and *
+		 * moved out & destroyed on pop                        */
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	rbnode * nodes;
+	size_t   mask;
+
+public:
+	static inline size_t bytes(size_t size) { return sizeof(rbnode) * size; };
+
+	inline void attach(void * mem, size_t size) {
+		nodes = static_cast<rbnode *>(mem);
+		mask  = size - 1;
+		for (size_t i = 0; i < size; ++i) { new (nodes + i) rbnode(); }
+	};
+
+	inline size_t                  slot(uint64_t ticket) const { return (size_t)(ticket & mask); };
+	inline std::atomic<uint32_t> & seq   (size_t s) { return nodes[s].seq; };
+	inline T *                     object(size_t s) { return reinterpret_cast<T *>(nodes[s].storage); };
+};
+
+/* objects packed in one array, seqs in another (4 bytes each):      *
+ * sizeof(T) + 4 bytes per slot. Tickets are transposed so that the  *
+ * 16 seqs of a line belong to tickets (size / 16) apart: neighbour  *
+ * tickets, i.e. concurrent producers (consumers), never share the   *
+ * line of their seq, and with sizeof(T) >= 4 nor of their object.   */
+template <typename T> class rbq_layout_dense
+{
+	enum { SHIFT = 4 };   /* log2(64 / sizeof(seq)) seqs per line */
+
+	std::atomic<uint32_t> * seqs;
+	unsigned char         * objs;
+	size_t                  mask;
+	size_t                  rows;   /* size >> SHIFT, lines of seqs */
+	int                     rbits;  /* log2(rows) */
+
+	static inline size_t seqbytes(size_t size) {
+		size_t align = (alignof(T) > 64) ? alignof(T) : 64;
+		return ((sizeof(std::atomic<uint32_t>) * size + align - 1) / align) * align;
 	};
 
+public:
+	static inline size_t bytes(size_t size) { return seqbytes(size) + sizeof(T) * size; };
+
+	inline void attach(void * mem, size_t size) {
+		seqs  = static_cast<std::atomic<uint32_t> *>(mem);
+		objs  = static_cast<unsigned char *>(mem) + seqbytes(size);
+		mask  = size - 1;
+		rows  = size >> SHIFT;
+		rbits = 0;
+		while (((size_t)1 << rbits) < rows) { ++rbits; }
+		for (size_t i = 0; i < size; ++i) { new (seqs + i) std::atomic<uint32_t>(0); }
+	};
+
+	inline size_t slot(uint64_t ticket) const {
+		size_t i = (size_t)(ticket & mask);
+		if (rows == 0) { return i; }   /* fewer slots than one line */
+		return ((i & (rows - 1)) << SHIFT) | (i >> rbits);
+	};
+
+	inline std::atomic<uint32_t> & seq   (size_t s) { return seqs[s]; };
+	inline T *                     object(size_t s) { return reinterpret_cast<T *>(objs + sizeof(T) * s); };
+};
+//////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+/* slot sequence numbers                                    */
+//////////////////////////////////////////////////////////////
+// The slot of ticket (i) in [0, size) starts with seq = i.
+// The producer of ticket (t) owns the slot once seq == t
+// and publishes with seq = t + 1, the consumer of ticket (t)
+// owns the slot once seq == t + 1 and frees it for the next
+// lap with seq = t + size.
+// Sequences are kept in 32 bits, compared by difference.
+//////////////////////////////////////////////////////////////
+template <
+	typename T, typename W = rbq_wait_sleep,
+	template <typename> class L = rbq_layout_padded
+> class rbqueue
+{
 protected:
 	alignas(64) std::atomic<uint64_t> head;
 	alignas(64) std::atomic<uint64_t> tail;
 
 	size_t   size;
-	rbnode * data;
+	void *   data;
+	int      mflags;  /* LFMEM_* flags of (data) */
+	L<T>     slots;
+	W        waiter;
 	
 	rbqueue() { ; };
+
+	/* wait until the slot of (index) reaches sequence (S1) */
+	inline size_t waitslot(uint64_t index, uint32_t S1)
+	{
+		size_t slot = slots.slot(index); uint32_t S0, spins = 0;
+		while ((S0 = slots.seq(slot).load(std::memory_order_acquire)) != S1)
+		{
+			waiter.wait(slots.seq(slot), S0, index, spins++);
+		}
+		return slot;
+	};
+
+	/* hand the slot over to the peer with sequence (S1) */
+	inline void postslot(size_t slot, uint32_t S1)
+	{
+		slots.seq(slot).store(S1, std::memory_order_release);
+		waiter.wake(slots.seq(slot));
+	};
+
 public:
-	rbqueue(int order) {
-		size = (1ULL << order);
-		data = new rbnode[size];
+	/* (flags): LFMEM_HUGEPAGE / LFMEM_POPULATE / LFMEM_LOCK backing */
+	rbqueue(int order, int flags = 0) {
+		size   = (1ULL << order);
+		mflags = flags;
+		data   = lfmem_alloc(L<T>::bytes(size), flags);
+		if (data == nullptr) { throw std::bad_alloc(); }
+		slots.attach(data, size);
+		for (size_t i = 0; i < size; ++i) {
+			slots.seq(slots.slot(i)).store((uint32_t)i, std::memory_order_relaxed);
+		}
 
 		head.store(0);
 		tail.store(0);
 	};
 
 	virtual ~rbqueue() {
-		delete[] data;
+		/* destroy objects still in queue (no concurrent access here) */
+		if (!std::is_trivially_destructible<T>::value) {
+			uint64_t _tail = tail.load(std::memory_order_relaxed);
+			uint64_t _head = head.load(std::memory_order_relaxed);
+			for (; _head < _tail; ++_head) {
+				slots.object(slots.slot(_head))->~T();
+			}
+		}
+		lfmem_free(data, L<T>::bytes(size), mflags);
 	};
 
 	inline bool isfull() {
@@ -89,38 +290,37 @@ public:
 
 	inline size_t getsize() { return size; };
 
-	inline bool push(const T & object)
+	/* move the slots to NUMA (node), e.g. lfmem_current_node() of the *
+	 * consumer; only for slots mapped with (flags != 0)                */
+	inline bool bind(int node) {
+		return (mflags != 0) && lfmem_bind(data, L<T>::bytes(size), node);
+	};
+
+	inline bool push(const T &  object) { return emplace(object);            };
+	inline bool push(      T && object) { return emplace(std::move(object)); };
+
+	/* construct the object in place @ mutiple producers */
+	template <typename... Args> inline bool emplace(Args &&... args)
 	{
 		uint64_t currReadIndexA, currWriteIndex, nextWriteIndex;
 
-		// do 
-		{
-			// check if queue full
-			currWriteIndex = tail.load(std::memory_order_relaxed);
-			currReadIndexA = head.load(std::memory_order_relaxed);
-			if (currWriteIndex >= (currReadIndexA + size)) { return false; }
-
-			// now perfrom the FAA operation on the write index. 
-			// the Space @ currWriteIndex will be reserved for us.
-			nextWriteIndex = tail.fetch_add(1);
-			currWriteIndex = nextWriteIndex & (size - 1);
-		}
-		// while (1);
+		// check if queue full
+		currWriteIndex = tail.load(std::memory_order_relaxed);
+		currReadIndexA = head.load(std::memory_order_relaxed);
+		if (currWriteIndex >= (currReadIndexA + size)) { return false; }
 
-		// We know now that space @ currWriteIndex is reserved for us.
-		// In case of slow reader, we use CAS to ensure a correct data swap
-		rbnode * pnode = data + currWriteIndex; uint32_t S0 = STATUS_EMPT;
-		while (!pnode->status.compare_exchange_weak(S0, STATUS_FILL))
-		{
-			S0 = STATUS_EMPT;
-			usleep((currWriteIndex & 1) + 1);
-		}
+		// now perfrom the FAA operation on the write index. 
+		// the Space @ nextWriteIndex will be reserved for us.
+		nextWriteIndex = tail.fetch_add(1);
+
+		// In case of slow reader, wait until the slot is released to our lap
+		size_t slot = waitslot(nextWriteIndex, (uint32_t)(nextWriteIndex));
 
 		/* fill - exclusive */
-		pnode->object = object;
+		new (slots.object(slot)) T(std::forward<Args>(args)...);
 
-		/* done - update status */
-		pnode->status.store(STATUS_FULL, std::memory_order_release);
+		/* done - publish to the reader of this lap */
+		postslot(slot, (uint32_t)(nextWriteIndex + 1));
 
 		return true;
 	};
@@ -130,34 +330,24 @@ public:
 	{
 		uint64_t currWritIndex, currReadIndex, nextReadIndex;
 
-		// do
-		{
-			// check if queue empty
-			currReadIndex = head.load(std::memory_order_relaxed);
-			currWritIndex = tail.load(std::memory_order_relaxed);
-			if (currReadIndex >= currWritIndex) { return false; }
-
-			// now perfrom the FAA operation on the read index. 
-			// the Space @ currReadIndex will be reserved for us.
-			nextReadIndex = head.fetch_add(1);
-			currReadIndex = nextReadIndex & (size - 1);
-		}
-		// while(1);
+		// check if queue empty
+		currReadIndex = head.load(std::memory_order_relaxed);
+		currWritIndex = tail.load(std::memory_order_relaxed);
+		if (currReadIndex >= currWritIndex) { return false; }
 
-		// We know now that space @ currReadIndex is reserved for us.
-		// In case of slow writer, we use CAS to ensure a correct data swap
-		rbnode * pnode = data + currReadIndex; uint32_t S0 = STATUS_FULL;
-		while (!pnode->status.compare_exchange_weak(S0, STATUS_READ))
-		{
-			S0 = STATUS_FULL;
-			usleep((currReadIndex & 1) + 1);
-		}
+		// now perfrom the FAA operation on the read index. 
+		// the Space @ nextReadIndex will be reserved for us.
+		nextReadIndex = head.fetch_add(1);
+
+		// In case of slow writer, wait until the slot is published to us
+		size_t slot = waitslot(nextReadIndex, (uint32_t)(nextReadIndex + 1));
 
-		/* read - exclusive */
-		object = pnode->object;
+		/* read - exclusive (move out & destroy) */
+		object = std::move(*slots.object(slot));
+		slots.object(slot)->~T();
 
-		/* done - update status */
-		pnode->status.store(STATUS_EMPT, std::memory_order_release);
+		/* done - release to the writer of next lap */
+		postslot(slot, (uint32_t)(nextReadIndex + size));
 
 		/* return - data */
 		return true;
@@ -166,52 +356,170 @@ public:
 	/* pop @ mutiple consumers */
 	inline T pop()
 	{
-		uint64_t currWritIndex, currReadIndex, nextReadIndex;
+		T object = T(); pop(object); return object;
+	};
+
+	/* push @ mutiple producers, never overcommit:               *
+	 * the slot is claimed (CAS on tail) only if it is free now, *
+	 * returns false at once if the queue is full.               */
+	inline bool try_push(const T &  object) { return try_emplace(object);            };
+	inline bool try_push(      T && object) { return try_emplace(std::move(object)); };
+
+	template <typename... Args> inline bool try_emplace(Args &&... args)
+	{
+		uint64_t currWriteIndex = tail.load(std::memory_order_relaxed);
+		size_t   slot;
+
+		while (1)
+		{
+			slot = slots.slot(currWriteIndex);
+			int32_t dif = (int32_t)(
+				slots.seq(slot).load(std::memory_order_acquire) - (uint32_t)(currWriteIndex)
+			);
+
+			if (dif == 0) {
+				/* slot free for our lap, try to claim it */
+				if (tail.compare_exchange_weak(currWriteIndex, currWriteIndex + 1)) { break; }
+			}
+			else if (dif < 0) {
+				/* slot still holds the previous lap, queue full */
+				return false;
+			}
+			else {
+				/* someone else claimed it, reload */
+				currWriteIndex = tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		/* fill - exclusive */
+		new (slots.object(slot)) T(std::forward<Args>(args)...);
+
+		/* done - publish to the reader of this lap */
+		postslot(slot, (uint32_t)(currWriteIndex + 1));
+
+		return true;
+	};
+
+	/* pop @ mutiple consumers, never overcommit:                 *
+	 * the slot is claimed (CAS on head) only if it is filled now, *
+	 * returns false at once if the queue is empty.               */
+	inline bool try_pop(T & object)
+	{
+		uint64_t currReadIndex = head.load(std::memory_order_relaxed);
+		size_t   slot;
 
-		// do
+		while (1)
 		{
-			// check if queue empty
-			currReadIndex = head.load(std::memory_order_relaxed);
-			currWritIndex = tail.load(std::memory_order_relaxed);
-			if (currReadIndex >= currWritIndex) {
-				return (T(0));
+			slot = slots.slot(currReadIndex);
+			int32_t dif = (int32_t)(
+				slots.seq(slot).load(std::memory_order_acquire) - (uint32_t)(currReadIndex + 1)
+			);
+
+			if (dif == 0) {
+				/* slot filled for our lap, try to claim it */
+				if (head.compare_exchange_weak(currReadIndex, currReadIndex + 1)) { break; }
 			}
+			else if (dif < 0) {
+				/* slot not (yet) filled, queue empty */
+				return false;
+			}
+			else {
+				/* someone else claimed it, reload */
+				currReadIndex = head.load(std::memory_order_relaxed);
+			}
+		}
+
+		/* read - exclusive (move out & destroy) */
+		object = std::move(*slots.object(slot));
+		slots.object(slot)->~T();
+
+		/* done - release to the writer of next lap */
+		postslot(slot, (uint32_t)(currReadIndex + size));
+
+		return true;
+	};
 
-			// now perfrom the FAA operation on the read index. 
-			// the Space @ currReadIndex will be reserved for us.
-			nextReadIndex = head.fetch_add(1);
-			currReadIndex = nextReadIndex & (size - 1);
+	/* push @ mutiple producers, reserve a range of slots with one FAA */
+	inline size_t push_bulk(const T * objects, size_t n)
+	{
+		uint64_t currReadIndexA, currWriteIndex, nextWriteIndex;
+
+		// check if queue full, and clamp n to the free space we saw
+		currWriteIndex = tail.load(std::memory_order_relaxed);
+		currReadIndexA = head.load(std::memory_order_relaxed);
+		if (currWriteIndex >= (currReadIndexA + size)) { return 0; }
+		if (n > (currReadIndexA + size - currWriteIndex)) {
+			n = (currReadIndexA + size - currWriteIndex);
 		}
-		// while(1);
+		if (n == 0) { return 0; }
+
+		// now perfrom the FAA operation on the write index. 
+		// the Space @ [nextWriteIndex, nextWriteIndex + n) will be reserved for us.
+		nextWriteIndex = tail.fetch_add(n);
 
-		// We know now that space @ currReadIndex is reserved for us.
-		// In case of slow writer, we use CAS to ensure a correct data swap
-		rbnode* pnode = data + currReadIndex; uint32_t S0 = STATUS_FULL;
-		while (!pnode->status.compare_exchange_weak(S0, STATUS_READ))
+		for (size_t i = 0; i < n; ++i)
 		{
-			S0 = STATUS_FULL;
-			usleep((currReadIndex & 1) + 1);
+			currWriteIndex = nextWriteIndex + i;
+			size_t slot = waitslot(currWriteIndex, (uint32_t)(currWriteIndex));
+
+			/* fill - exclusive */
+			new (slots.object(slot)) T(objects[i]);
+
+			/* done - publish to the reader of this lap */
+			postslot(slot, (uint32_t)(currWriteIndex + 1));
 		}
 
-		/* read - exclusive */
-		T object(pnode->object);
+		return n;
+	};
 
-		/* done - update status */
-		pnode->status.store(STATUS_EMPT, std::memory_order_release);
+	/* pop @ mutiple consumers, reserve a range of slots with one FAA */
+	inline size_t pop_bulk(T * objects, size_t n)
+	{
+		uint64_t currWritIndex, currReadIndex, nextReadIndex;
 
-		/* return - data */
-		return object;
+		// check if queue empty, and clamp n to the objects we saw
+		currReadIndex = head.load(std::memory_order_relaxed);
+		currWritIndex = tail.load(std::memory_order_relaxed);
+		if (currReadIndex >= currWritIndex) { return 0; }
+		if (n > (currWritIndex - currReadIndex)) {
+			n = (currWritIndex - currReadIndex);
+		}
+		if (n == 0) { return 0; }
+
+		// now perfrom the FAA operation on the read index. 
+		// the Space @ [nextReadIndex, nextReadIndex + n) will be reserved for us.
+		nextReadIndex = head.fetch_add(n);
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			currReadIndex = nextReadIndex + i;
+			size_t slot = waitslot(currReadIndex, (uint32_t)(currReadIndex + 1));
+
+			/* read - exclusive (move out & destroy) */
+			objects[i] = std::move(*slots.object(slot));
+			slots.object(slot)->~T();
+
+			/* done - release to the writer of next lap */
+			postslot(slot, (uint32_t)(currReadIndex + size));
+		}
+
+		return n;
 	};
 
 	/* push @ single producer single consumer */
-	inline bool pushspsc(const T & object)
+	inline bool pushspsc(const T &  object) { return emplacespsc(object);            };
+	inline bool pushspsc(      T && object) { return emplacespsc(std::move(object)); };
+
+	template <typename... Args> inline bool emplacespsc(Args &&... args)
 	{
+		/* acquire: the consumer is done with the slot it released */
 		uint64_t currWriteIndex = tail.load(std::memory_order_relaxed);
-		uint64_t currReadIndexA = head.load(std::memory_order_relaxed);
+		uint64_t currReadIndexA = head.load(std::memory_order_acquire);
 		if (currWriteIndex >= (currReadIndexA + size)) { return false; }
 
-		data[currWriteIndex & (size - 1)].object = object;
-		tail.store(currWriteIndex + 1, std::memory_order_relaxed);
+		/* release: the object is constructed before the consumer sees it */
+		new (slots.object(slots.slot(currWriteIndex))) T(std::forward<Args>(args)...);
+		tail.store(currWriteIndex + 1, std::memory_order_release);
 		
 		return true;
 	}
@@ -219,12 +527,15 @@ public:
 	/* pop @ single producer single consumer */
 	inline bool popspsc(T & object)
 	{
+		/* acquire: pairs with the release of tail in emplacespsc() */
 		uint64_t currReadIndex = head.load(std::memory_order_relaxed);
-		uint64_t currWritIndex = tail.load(std::memory_order_relaxed);
+		uint64_t currWritIndex = tail.load(std::memory_order_acquire);
 		if (currReadIndex >= currWritIndex) { return false; };
 
-		object = data[currReadIndex & (size - 1)].object;
-		head.store(currReadIndex + 1, std::memory_order_relaxed);
+		/* release: the object is moved out and destroyed before the slot is reused */
+		T * pobj = slots.object(slots.slot(currReadIndex));
+		object = std::move(*pobj); pobj->~T();
+		head.store(currReadIndex + 1, std::memory_order_release);
 		
 		return (true);
 	};
@@ -232,14 +543,7 @@ public:
 	/* pop @ single producer single consumer */
 	inline T popspsc()
 	{
-		uint64_t currReadIndex = head.load(std::memory_order_relaxed);
-		uint64_t currWritIndex = tail.load(std::memory_order_relaxed);
-		if (currReadIndex >= currWritIndex) { return false; };
-
-		T object(data[currReadIndex & (size - 1)].object);
-		head.store(currReadIndex + 1, std::memory_order_relaxed);
-
-		return (object);
+		T object = T(); popspsc(object); return object;
 	};
 };
 
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <utility>
+
+#include "rbq.hpp"
+#include "lfthread.hpp"
+
+#ifndef __LOCKFREE_RBQ_LANES_H__
+#define __LOCKFREE_RBQ_LANES_H__
+
+//////////////////////////////////////////////////////////////
+/* striped MPMC queue: K rbqueue lanes                      */
+//////////////////////////////////////////////////////////////
+// Producers push into a home lane picked by thread index
+// (or by a caller supplied hash) and spill over to the next
+// lanes only when it is full; consumers sweep all lanes with
+// a rotating start, using try_pop so that a lane with a slow
+// writer never blocks the sweep.
+//
+// head/tail traffic is spread over K pairs of cache lines,
+// FIFO order is kept per lane only (not globally).
+//////////////////////////////////////////////////////////////
+template <
+	typename T, typename W = rbq_wait_sleep,
+	template <typename> class L = rbq_layout_padded
+> class rbqlanes
+{
+protected:
+	size_t           nlanes;
+	rbqueue<T, W, L> ** lanes;
+
+	rbqlanes() { ; };
+
+	static inline uint32_t & cursor() {
+		thread_local uint32_t _cursor = (uint32_t)lf_thread_index();
+		return _cursor;
+	};
+
+	template <typename... Args> inline bool emplace_from(size_t lane, Args &&... args)
+	{
+		for (size_t i = 0; i < nlanes; ++i) {
+			if (lanes[(lane + i) % nlanes]->emplace(std::forward<Args>(args)...)) { return true; }
+		}
+		return false;
+	};
+
+public:
+	/* K = (lanes) queues, each of size (1 << order), LFMEM_* (flags) */
+	rbqlanes(int lanes_, int order, int flags = 0) {
+		nlanes = (lanes_ > 0) ? lanes_ : 1;
+		lanes  = new rbqueue<T, W, L> *[nlanes];
+		for (size_t i = 0; i < nlanes; ++i) {
+			lanes[i] = new rbqueue<T, W, L>(order, flags);
+		}
+	};
+
+	virtual ~rbqlanes() {
+		for (size_t i = 0; i < nlanes; ++i) { delete lanes[i]; }
+		delete[] lanes;
+	};
+
+	inline bool isfull() {
+		for (size_t i = 0; i < nlanes; ++i) { if (!lanes[i]->isfull()) { return false; } }
+		return true;
+	};
+
+	inline bool isempty() {
+		for (size_t i = 0; i < nlanes; ++i) { if (!lanes[i]->isempty()) { return false; } }
+		return true;
+	};
+
+	inline size_t getsize() { return nlanes * lanes[0]->getsize(); };
+	inline size_t getlanes() { return nlanes; };
+
+	/* push @ mutiple producers, into the home lane of this thread */
+	inline bool push(const T &  object) { return emplace_from(lf_thread_index() % nlanes, object);            };
+	inline bool push(      T && object) { return emplace_from(lf_thread_index() % nlanes, std::move(object)); };
+
+	/* push @ mutiple producers, into the lane picked by (hash) */
+	inline bool push(size_t hash, const T &  object) { return emplace_from(hash % nlanes, object);            };
+	inline bool push(size_t hash,       T && object) { return emplace_from(hash % nlanes, std::move(object)); };
+
+	template <typename... Args> inline bool emplace(Args &&... args)
+	{
+		return emplace_from(lf_thread_index() % nlanes, std::forward<Args>(args)...);
+	};
+
+	/* pop @ mutiple consumers, sweep lanes from a rotating start */
+	inline bool pop(T & object)
+	{
+		size_t start = (cursor()++) % nlanes;
+		for (size_t i = 0; i < nlanes; ++i) {
+			if (lanes[(start + i) % nlanes]->try_pop(object)) { return true; }
+		}
+		return false;
+	};
+
+	/* pop @ mutiple consumers */
+	inline T pop()
+	{
+		T object = T(); pop(object); return object;
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include "rbq.hpp"
+#include "lffifo.hpp"
+#include "lfmem.hpp"
+#include "smr.hpp"
+
+#ifndef __LOCKFREE_RBQ_LIST_H__
+#define __LOCKFREE_RBQ_LIST_H__
+
+//////////////////////////////////////////////////////////////
+/* unbounded MPMC queue: a linked list of ring segments     */
+//////////////////////////////////////////////////////////////
+// Each segment is an array of (1 << order) slots used for one
+// lap only (as in LCRQ / FAA array queues): producers take a
+// slot with a FAA on the segment tail, consumers with a FAA on
+// the segment head, so the fast path costs one FAA as in
+// rbqueue. A producer that overshoots the tail appends a new
+// segment, a consumer that overshoots the head moves on to the
+// next one and retires the drained segment.
+//
+// A consumer that reaches a slot before its producer marks it
+// TAKEN, the producer then retries with a fresh ticket.
+//
+// Segments are protected by hazard pointers while in use and
+// recycled through a freelist of up to (keep) segments once
+// drained, so a steady state allocates nothing. Segments are
+// large and few, so each retire is scanned right away.
+//////////////////////////////////////////////////////////////
+template <typename T, template <typename> class L = rbq_layout_padded> class rbqlist
+{
+	enum : uint32_t { EMPTY = 0, FULL = 1, TAKEN = 2 };
+
+	struct rbqseg
+	{
+		lf_pointer_t link;  /* freelist link, first member */
+
+		alignas(64) std::atomic<uint64_t> head;
+		alignas(64) std::atomic<uint64_t> tail;
+		alignas(64) std::atomic<rbqseg *> next;
+		L<T> slots;
+	};
+
+protected:
+	alignas(64) std::atomic<rbqseg *> headseg;
+	alignas(64) std::atomic<rbqseg *> tailseg;
+	alignas(64) lf_atomic_pointer_t freelist;
+	std::atomic<size_t> nfree;
+
+	uint64_t      size;    /* slots per segment */
+	size_t        keep;    /* max segments on the freelist */
+	int           mflags;  /* LFMEM_* flags of the segments */
+	lf_hazard<1>  hazard;
+
+	static inline size_t segbytes(size_t size) {
+		return lfmem_round(sizeof(rbqseg), 64) + L<T>::bytes(size);
+	};
+
+	/* a fresh empty segment, from the freelist if possible */
+	inline rbqseg * getseg()
+	{
+		rbqseg * seg = reinterpret_cast<rbqseg *>(lfstack_pop_internal(&freelist));
+		if (seg != nullptr) {
+			nfree.fetch_sub(1, std::memory_order_relaxed);
+		} else {
+			void * mem = lfmem_alloc(segbytes(size), mflags);
+			if (mem == nullptr) { return nullptr; }
+
+			seg = new (mem) rbqseg();
+			seg->slots.attach(static_cast<unsigned char *>(mem) + lfmem_round(sizeof(rbqseg), 64), size);
+		}
+
+		seg->head.store(0, std::memory_order_relaxed);
+		seg->tail.store(0, std::memory_order_relaxed);
+		seg->next.store(nullptr, std::memory_order_relaxed);
+		for (uint64_t i = 0; i < size; ++i) {
+			seg->slots.seq(i).store(EMPTY, std::memory_order_relaxed);
+		}
+		return seg;
+	};
+
+	/* a segment no thread can reach any more */
+	inline void putseg(rbqseg * seg)
+	{
+		if (nfree.fetch_add(1, std::memory_order_relaxed) < keep) {
+			lfstack_push_internal(&freelist, &(seg->link));
+		} else {
+			nfree.fetch_sub(1, std::memory_order_relaxed);
+			freeseg(seg);
+		}
+	};
+
+	inline void freeseg(rbqseg * seg)
+	{
+		seg->~rbqseg();
+		lfmem_free(seg, segbytes(size), mflags);
+	};
+
+	static void reclaim(void * ctx, void * p) {
+		static_cast<rbqlist *>(ctx)->putseg(static_cast<rbqseg *>(p));
+	};
+
+	/* link a new segment after (seg), or help the winner */
+	inline bool grow(rbqseg * seg)
+	{
+		rbqseg * next = seg->next.load(std::memory_order_acquire);
+		if (next == nullptr) {
+			rbqseg * fresh = getseg();
+			if (fresh == nullptr) { return false; }
+
+			if (seg->next.compare_exchange_strong(next, fresh)) {
+				next = fresh;
+			} else {
+				/* never published, no hazard to wait for */
+				putseg(fresh);
+			}
+		}
+		tailseg.compare_exchange_strong(seg, next);
+		return true;
+	};
+
+public:
+	/* segments of (1 << order) slots, at most (keep_) of them cached, LFMEM_* (flags) */
+	rbqlist(int order, size_t keep_ = 4, int flags = 0) : hazard(reclaim, this, 1) {
+		size   = (1ULL << order);
+		keep   = keep_;
+		mflags = flags;
+		nfree.store(0);
+		lfstack_init_internal(&freelist);
+
+		rbqseg * seg = getseg();
+		if (seg == nullptr) { throw std::bad_alloc(); }
+		headseg.store(seg);
+		tailseg.store(seg);
+	};
+
+	virtual ~rbqlist() {
+		/* destroy objects still in queue (no concurrent access here) */
+		rbqseg * seg = headseg.load();
+		while (seg != nullptr) {
+			rbqseg * next = seg->next.load();
+			uint64_t tail = seg->tail.load();
+			for (uint64_t i = seg->head.load(); (i < tail) && (i < size); ++i) {
+				size_t slot = seg->slots.slot(i);
+				if (seg->slots.seq(slot).load() == FULL) { seg->slots.object(slot)->~T(); }
+			}
+			freeseg(seg);
+			seg = next;
+		}
+
+		/* retired segments go to the freelist first */
+		hazard.drain();
+		while ((seg = reinterpret_cast<rbqseg *>(lfstack_pop_internal(&freelist))) != nullptr) {
+			freeseg(seg);
+		}
+	};
+
+	inline bool isempty() {
+		rbqseg * seg = hazard.protect(0, headseg);
+		bool empty = (seg->head.load() >= seg->tail.load()) && (seg->next.load() == nullptr);
+		hazard.clear(0);
+		return empty;
+	};
+
+	inline size_t getsize() { return size; };
+
+	/* push @ mutiple producers, false only when out of memory */
+	inline bool push(const T &  object) { return emplace(object);            };
+	inline bool push(      T && object) { return emplace(std::move(object)); };
+
+	template <typename... Args> inline bool emplace(Args &&... args)
+	{
+		/* object of a slot lost to a consumer, moved on to the next ticket */
+		alignas(T) unsigned char spare[sizeof(T)];
+		T * pending = nullptr;
+
+		while (1)
+		{
+			rbqseg * seg = hazard.protect(0, tailseg);
+			uint64_t idx = seg->tail.fetch_add(1);
+
+			if (idx >= size) {
+				/* segment full, append the next one */
+				if (!grow(seg)) {
+					if (pending) { pending->~T(); }
+					hazard.clear(0); return false;
+				}
+				continue;
+			}
+
+			/* fill - exclusive */
+			size_t slot = seg->slots.slot(idx);
+			T * pobj = seg->slots.object(slot);
+			if (pending) {
+				new (pobj) T(std::move(*pending));
+				pending->~T();
+			} else {
+				new (pobj) T(std::forward<Args>(args)...);
+			}
+
+			/* done - publish, unless the consumer gave up on this slot */
+			uint32_t S0 = EMPTY;
+			if (seg->slots.seq(slot).compare_exchange_strong(S0, FULL, std::memory_order_release)) {
+				hazard.clear(0); return true;
+			}
+
+			pending = new (spare) T(std::move(*pobj));
+			pobj->~T();
+		}
+	};
+
+	/* pop @ mutiple consumers, false if empty */
+	inline bool pop(T & object)
+	{
+		while (1)
+		{
+			rbqseg * seg = hazard.protect(0, headseg);
+
+			/* check queue empty */
+			if ((seg->head.load() >= seg->tail.load()) && (seg->next.load() == nullptr)) {
+				hazard.clear(0); return false;
+			}
+
+			uint64_t idx = seg->head.fetch_add(1);
+			if (idx >= size) {
+				/* segment drained, move on to the next one */
+				rbqseg * next = seg->next.load(std::memory_order_acquire);
+				if (next == nullptr) { hazard.clear(0); return false; }
+
+				/* never let the head pass the tail */
+				rbqseg * expected = seg;
+				tailseg.compare_exchange_strong(expected, next);
+
+				expected = seg;
+				if (headseg.compare_exchange_strong(expected, next)) {
+					hazard.clear(0);
+					hazard.retire(seg);
+				}
+				continue;
+			}
+
+			/* a slow producer still owns the slot: take it away */
+			size_t slot = seg->slots.slot(idx);
+			uint32_t S0 = EMPTY;
+			if (seg->slots.seq(slot).compare_exchange_strong(S0, TAKEN, std::memory_order_acquire)) {
+				continue;
+			}
+
+			/* read - exclusive (move out & destroy) */
+			object = std::move(*seg->slots.object(slot));
+			seg->slots.object(slot)->~T();
+
+			hazard.clear(0);
+			return true;
+		}
+	};
+
+	/* pop @ mutiple consumers */
+	inline T pop()
+	{
+		T object = T(); pop(object); return object;
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
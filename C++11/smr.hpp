@@ -0,0 +1,313 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include "lfthread.hpp"
+
+#ifndef __LOCKFREE_SMR_H__
+#define __LOCKFREE_SMR_H__
+
+/* retired objects per thread before a reclaim pass */
+#ifndef LF_SMR_BATCH
+#define LF_SMR_BATCH 64
+#endif
+
+//////////////////////////////////////////////////////////////
+/* reclaimers share one interface, picked by template arg   */
+//////////////////////////////////////////////////////////////
+//   enter() / leave()  : around every operation that reads
+//                        shared nodes
+//   protect(k, src)    : load (src) for use until leave()
+//   clear(k)           : done with slot (k) before leave()
+//   retire(p)          : (p) is unlinked, reclaim it later
+//   poll()             : a reclaim pass of this thread now
+//   drain()            : reclaim everything, no thread inside
+//
+// Retired objects are kept per thread and reclaimed in
+// batches of (batch), so a retire costs a push_back most of
+// the time.
+//////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+/* hazard pointers (Michael 2004)                           */
+//////////////////////////////////////////////////////////////
+// Each thread (lf_thread_index) owns K hazard slots and a
+// retire list. A reader publishes the pointer it is about to
+// dereference with protect(), which re-reads the source until
+// the published value is still current; a remover hands the
+// unlinked object to retire(), and it is given to (reclaim)
+// once no hazard slot holds it any more.
+//
+// Objects must be unlinked (unreachable from the shared
+// structure) before they are retired. A reclaim pass sorts a
+// snapshot of all hazard slots once, then looks every retired
+// object up in it.
+//////////////////////////////////////////////////////////////
+template <int K = 1> class lf_hazard
+{
+public:
+	typedef void (*reclaim_t)(void * ctx, void * p);
+
+protected:
+	struct alignas(64) record
+	{
+		std::atomic<void *>  hp[K];
+		std::vector<void *>  retired;  /* owner thread only */
+		std::vector<void *>  snap;     /* owner thread only, scan() scratch */
+	};
+
+	record *  recs;
+	reclaim_t reclaim;
+	void *    ctx;
+	size_t    batch;
+
+	/* hand back every retired object that is not protected */
+	inline void scan(record & rec)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		std::vector<void *> & snap = rec.snap;
+		snap.clear();
+		for (int t = 0; t < LF_MAXTHREADS; ++t) {
+			for (int k = 0; k < K; ++k) {
+				void * p = recs[t].hp[k].load(std::memory_order_acquire);
+				if (p != nullptr) { snap.push_back(p); }
+			}
+		}
+		std::sort(snap.begin(), snap.end());
+
+		std::vector<void *> & retired = rec.retired;
+		size_t keep = 0;
+		for (size_t i = 0; i < retired.size(); ++i) {
+			if (std::binary_search(snap.begin(), snap.end(), retired[i])) { retired[keep++] = retired[i]; }
+			else                                                          { reclaim(ctx, retired[i]);     }
+		}
+		retired.resize(keep);
+	};
+
+public:
+	/* a reclaim pass every (batch_) retires of a thread */
+	lf_hazard(reclaim_t reclaim_, void * ctx_, size_t batch_ = LF_SMR_BATCH)
+		: reclaim(reclaim_), ctx(ctx_), batch(batch_ ? batch_ : 1) {
+		recs = new record[LF_MAXTHREADS];
+		for (int t = 0; t < LF_MAXTHREADS; ++t) {
+			for (int k = 0; k < K; ++k) { recs[t].hp[k].store(nullptr, std::memory_order_relaxed); }
+		}
+	};
+
+	/* everything still retired is reclaimed (no concurrent access here) */
+	virtual ~lf_hazard() {
+		drain();
+		delete[] recs;
+	};
+
+	/* load (src) into hazard slot (k) of this thread */
+	template <typename P> inline P * protect(int k, const std::atomic<P *> & src)
+	{
+		std::atomic<void *> & hp = recs[lf_thread_index()].hp[k];
+		P * p = src.load(std::memory_order_relaxed);
+		while (1) {
+			hp.store(p, std::memory_order_seq_cst);
+
+			P * q = src.load(std::memory_order_seq_cst);
+			if (q == p) { return p; }
+			p = q;
+		}
+	};
+
+	inline void clear(int k) {
+		recs[lf_thread_index()].hp[k].store(nullptr, std::memory_order_release);
+	};
+
+	inline void enter() { ; };
+
+	inline void leave() {
+		record & rec = recs[lf_thread_index()];
+		for (int k = 0; k < K; ++k) { rec.hp[k].store(nullptr, std::memory_order_release); }
+	};
+
+	inline bool hazardous(void * p) {
+		for (int t = 0; t < LF_MAXTHREADS; ++t) {
+			for (int k = 0; k < K; ++k) {
+				if (recs[t].hp[k].load(std::memory_order_acquire) == p) { return true; }
+			}
+		}
+		return false;
+	};
+
+	/* (p) is unlinked, reclaim it once no thread protects it */
+	inline void retire(void * p)
+	{
+		record & rec = recs[lf_thread_index()];
+		rec.retired.push_back(p);
+		if (rec.retired.size() >= batch) { scan(rec); }
+	};
+
+	/* reclaim what this thread retired and nobody protects, ahead of the batch */
+	inline void poll()
+	{
+		record & rec = recs[lf_thread_index()];
+		if (!rec.retired.empty()) { scan(rec); }
+	};
+
+	/* reclaim all retired objects, only when no thread is inside */
+	inline void drain() {
+		for (int t = 0; t < LF_MAXTHREADS; ++t) {
+			for (size_t i = 0; i < recs[t].retired.size(); ++i) { reclaim(ctx, recs[t].retired[i]); }
+			recs[t].retired.clear();
+		}
+	};
+};
+//////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+/* epoch based reclamation (Fraser 2004)                    */
+//////////////////////////////////////////////////////////////
+// A thread inside enter() / leave() announces the global
+// epoch it saw. An object retired in epoch (e) is reclaimed
+// once the global epoch reached (e + 2): the epoch only moves
+// on when every thread inside has seen the current one, so
+// nobody can still hold a pointer read before the unlink.
+//
+// protect() is a plain load, so reads cost nothing; the price
+// is that one thread stalled inside holds back reclamation
+// for everybody (hazard pointers bound it instead).
+//////////////////////////////////////////////////////////////
+class lf_epoch
+{
+public:
+	typedef void (*reclaim_t)(void * ctx, void * p);
+
+protected:
+	struct retired_t
+	{
+		void *   p;
+		uint64_t epoch;
+	};
+
+	struct alignas(64) record
+	{
+		std::atomic<uint64_t>   local;    /* (epoch << 1) | 1 while inside, 0 outside */
+		std::vector<retired_t>  retired;  /* owner thread only */
+	};
+
+	alignas(64) std::atomic<uint64_t> global;
+
+	record *  recs;
+	reclaim_t reclaim;
+	void *    ctx;
+	size_t    batch;
+
+	/* move the global epoch on if every thread inside saw it */
+	inline void advance()
+	{
+		uint64_t e = global.load(std::memory_order_seq_cst);
+		for (int t = 0; t < LF_MAXTHREADS; ++t) {
+			uint64_t l = recs[t].local.load(std::memory_order_acquire);
+			if ((l & 1) && ((l >> 1) != e)) { return; }
+		}
+		global.compare_exchange_strong(e, e + 1);
+	};
+
+	/* hand back every retired object two epochs old */
+	inline void collect(std::vector<retired_t> & retired)
+	{
+		uint64_t e = global.load(std::memory_order_acquire);
+
+		size_t keep = 0;
+		for (size_t i = 0; i < retired.size(); ++i) {
+			if (retired[i].epoch + 2 > e) { retired[keep++] = retired[i];   }
+			else                          { reclaim(ctx, retired[i].p);     }
+		}
+		retired.resize(keep);
+	};
+
+public:
+	/* a reclaim pass every (batch_) retires of a thread */
+	lf_epoch(reclaim_t reclaim_, void * ctx_, size_t batch_ = LF_SMR_BATCH)
+		: global(0), reclaim(reclaim_), ctx(ctx_), batch(batch_ ? batch_ : 1) {
+		recs = new record[LF_MAXTHREADS];
+		for (int t = 0; t < LF_MAXTHREADS; ++t) { recs[t].local.store(0, std::memory_order_relaxed); }
+	};
+
+	/* everything still retired is reclaimed (no concurrent access here) */
+	virtual ~lf_epoch() {
+		drain();
+		delete[] recs;
+	};
+
+	inline void enter()
+	{
+		std::atomic<uint64_t> & local = recs[lf_thread_index()].local;
+		uint64_t e = global.load(std::memory_order_relaxed);
+		while (1) {
+			local.store((e << 1) | 1, std::memory_order_seq_cst);
+
+			/* announced before the epoch moved on */
+			uint64_t f = global.load(std::memory_order_seq_cst);
+			if (f == e) { return; }
+			e = f;
+		}
+	};
+
+	inline void leave() {
+		recs[lf_thread_index()].local.store(0, std::memory_order_release);
+	};
+
+	template <typename P> inline P * protect(int, const std::atomic<P *> & src) {
+		return src.load(std::memory_order_acquire);
+	};
+
+	inline void clear(int) { ; };
+
+	/* (p) is unlinked, reclaim it two epochs later */
+	inline void retire(void * p)
+	{
+		std::vector<retired_t> & retired = recs[lf_thread_index()].retired;
+		retired_t r;
+		r.p     = p;
+		r.epoch = global.load(std::memory_order_seq_cst);
+		retired.push_back(r);
+
+		if (retired.size() >= batch) {
+			advance();
+			collect(retired);
+		}
+	};
+
+	/* reclaim what this thread retired, ahead of the batch: the epoch  *
+	 * is moved on until the oldest entry is two epochs old, or until a *
+	 * thread inside holds it back                                      */
+	inline void poll()
+	{
+		std::vector<retired_t> & retired = recs[lf_thread_index()].retired;
+		if (retired.empty()) { return; }
+
+		uint64_t oldest = retired[0].epoch;
+		for (size_t i = 1; i < retired.size(); ++i) {
+			if (retired[i].epoch < oldest) { oldest = retired[i].epoch; }
+		}
+
+		uint64_t e = global.load(std::memory_order_acquire);
+		while (e < oldest + 2) {
+			advance();
+			uint64_t f = global.load(std::memory_order_acquire);
+			if (f == e) { break; }
+			e = f;
+		}
+		collect(retired);
+	};
+
+	/* reclaim all retired objects, only when no thread is inside */
+	inline void drain() {
+		for (int t = 0; t < LF_MAXTHREADS; ++t) {
+			for (size_t i = 0; i < recs[t].retired.size(); ++i) { reclaim(ctx, recs[t].retired[i].p); }
+			recs[t].retired.clear();
+		}
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
+
+#include "lfatomic.hpp"
+#include "lfmem.hpp"
+#include "lfthread.hpp"
+
+#ifndef __WAITFREE_QUEUE_MPMC_H__
+#define __WAITFREE_QUEUE_MPMC_H__
+
+//////////////////////////////////////////////////////////////
+/* wait-free bounded MPMC queue (P-Sim combining)           */
+//////////////////////////////////////////////////////////////
+// Fatourou & Kallimanis, "A highly-efficient wait-free
+// universal construction" (SPAA 2011), over a ring buffer.
+//
+// A thread announces its operation, then makes at most two
+// attempts to install a new queue state {head, tail, result of
+// every thread} built from the current one plus every pending
+// announcement. Whoever wins applies the ops of all announced
+// threads, so after two failed attempts the op of the caller
+// has been applied by somebody else. There is no other loop:
+// an operation takes O(threads) steps whatever the others do.
+//
+// Values move in a second phase that every thread replays for
+// the current state before it may install the next one: pops
+// of the round are delivered to their thread, then the pushes
+// of the round are written into the ring. Slots and results
+// are tagged (position / op number) so that a stale helper
+// can never overwrite newer data.
+//
+// T must be trivially copyable and at most 8 bytes (a value or
+// a pointer); slots and results are 16-byte {tag, value} DWCAS.
+//////////////////////////////////////////////////////////////
+template <typename T> class wfqueue
+{
+	static_assert(std::is_trivially_copyable<T>::value && (sizeof(T) <= 8),
+		"wfqueue<T>: T must be trivially copyable and fit in 8 bytes");
+
+	struct alignas(16) wfword
+	{
+		uint64_t tag;
+		uint64_t val;
+	};
+
+	/* apos = (position << 3) | RES_* */
+	enum : uint64_t { RES_OK = 1, RES_PUSH = 2, RES_POP = 4 };
+	enum : uint64_t { NOSRC = ~0ULL };
+
+	/* state of one thread: last op applied, and its outcome */
+	struct wfentry
+	{
+		std::atomic<uint64_t> aseq;    /* number of the op */
+		std::atomic<uint64_t> apos;    /* outcome, RES_* */
+		std::atomic<uint64_t> around;  /* version it was applied in */
+		std::atomic<uint64_t> asrc;    /* pop of a slot pushed in the same round: pusher */
+	};
+
+	struct alignas(64) wfstate
+	{
+		std::atomic<uint64_t> version;
+		std::atomic<uint64_t> head;
+		std::atomic<uint64_t> tail;
+		wfentry               e[LF_MAXTHREADS];
+	};
+
+	struct alignas(64) wfannounce
+	{
+		std::atomic<uint64_t> seq;     /* number of the announced op */
+		std::atomic<uint64_t> kind;    /* RES_PUSH / RES_POP */
+		std::atomic<uint64_t> val;     /* pushed value */
+		lf_atomic16<wfword>   result;  /* {(seq << 1) | ok, popped value} */
+		uint64_t              nops;    /* owner only */
+	};
+
+protected:
+	alignas(64) std::atomic<uint64_t> current;   /* (version << 16) | record */
+	alignas(64) std::atomic<uint32_t> nthreads;  /* highest thread index + 1 */
+
+	size_t                size;
+	lf_atomic16<wfword> * ring;
+	wfstate *             pool;      /* 2 records per thread */
+	wfannounce *          ann;
+	int                   mflags;    /* LFMEM_* flags of (ring) */
+
+	wfqueue() { ; };
+
+	static inline uint64_t tovalue(const T & object) {
+		uint64_t v = 0; memcpy(&v, &object, sizeof(T)); return v;
+	};
+
+	static inline T fromvalue(uint64_t v) {
+		T object; memcpy(&object, &v, sizeof(T)); return object;
+	};
+
+	inline wfstate * record(uint64_t cur) { return pool + (cur & 0xffff); };
+
+	/* one of our two records that is not the current state */
+	inline uint32_t ownrecord(uint32_t me, uint64_t cur) {
+		uint32_t idx = (uint32_t)(cur & 0xffff);
+		return (idx >> 1 == me) ? (idx ^ 1) : (me << 1);
+	};
+
+	/* copy the state of (cur) into (dst), false if it changed meanwhile */
+	inline bool snapshot(wfstate * dst, uint64_t cur, uint32_t n)
+	{
+		const wfstate * src = record(cur);
+
+		/* no reader may see our writes without seeing (cur) replaced */
+		std::atomic_thread_fence(std::memory_order_release);
+
+		dst->version.store(src->version.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		dst->head   .store(src->head   .load(std::memory_order_relaxed), std::memory_order_relaxed);
+		dst->tail   .store(src->tail   .load(std::memory_order_relaxed), std::memory_order_relaxed);
+		for (uint32_t i = 0; i < n; ++i) {
+			dst->e[i].aseq  .store(src->e[i].aseq  .load(std::memory_order_relaxed), std::memory_order_relaxed);
+			dst->e[i].apos  .store(src->e[i].apos  .load(std::memory_order_relaxed), std::memory_order_relaxed);
+			dst->e[i].around.store(src->e[i].around.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			dst->e[i].asrc  .store(src->e[i].asrc  .load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return current.load(std::memory_order_relaxed) == cur;
+	};
+
+	/* hand (word) to (dst) unless it already holds (tag) or later */
+	static inline void publish(lf_atomic16<wfword> & dst, wfword expect, wfword word) {
+		if (expect.tag < word.tag) { dst.compare_exchange_strong(expect, word); }
+	};
+
+	/* move the values of the ops applied in state (s), idempotent */
+	inline void transfer(const wfstate * s, uint32_t n)
+	{
+		uint64_t version = s->version.load(std::memory_order_relaxed);
+
+		/* pops first, their slot may be pushed again in this round */
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			const wfentry & e = s->e[i];
+			uint64_t apos = e.apos.load(std::memory_order_relaxed);
+			if ((e.around.load(std::memory_order_relaxed) != version) || !(apos & RES_POP)) { continue; }
+
+			wfword res = { (e.aseq.load(std::memory_order_relaxed) << 1) | (apos & RES_OK), 0 };
+			wfword old = ann[i].result.load(std::memory_order_acquire);
+			if (old.tag >= res.tag) { continue; }
+
+			if (apos & RES_OK) {
+				uint64_t pos  = apos >> 3;
+				uint64_t src  = e.asrc.load(std::memory_order_relaxed);
+				if (src != NOSRC) {
+					/* pushed in this round, not in the ring yet */
+					res.val = ann[src].val.load(std::memory_order_acquire);
+				} else {
+					wfword slot = ring[pos & (size - 1)].load(std::memory_order_acquire);
+					if (slot.tag != pos + 1) { continue; }  /* delivered and reused */
+					res.val = slot.val;
+				}
+			}
+			publish(ann[i].result, old, res);
+		}
+
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			const wfentry & e = s->e[i];
+			uint64_t apos = e.apos.load(std::memory_order_relaxed);
+			if ((e.around.load(std::memory_order_relaxed) != version) || !(apos & RES_PUSH)) { continue; }
+
+			if (apos & RES_OK) {
+				uint64_t pos  = apos >> 3;
+				wfword   slot = ring[pos & (size - 1)].load(std::memory_order_acquire);
+				if (slot.tag < pos + 1) {
+					wfword word = { pos + 1, ann[i].val.load(std::memory_order_acquire) };
+					publish(ring[pos & (size - 1)], slot, word);
+				}
+			}
+
+			wfword res = { (e.aseq.load(std::memory_order_relaxed) << 1) | (apos & RES_OK), 0 };
+			publish(ann[i].result, ann[i].result.load(std::memory_order_acquire), res);
+		}
+	};
+
+	/* apply every pending announcement on top of state (s) */
+	inline void combine(wfstate * s, uint32_t n)
+	{
+		uint64_t version = s->version.load(std::memory_order_relaxed) + 1;
+		uint64_t head    = s->head.load(std::memory_order_relaxed);
+		uint64_t tail    = s->tail.load(std::memory_order_relaxed);
+		uint64_t tail0   = tail;
+		uint32_t pushers[LF_MAXTHREADS];   /* pusher of position (tail0 + j) */
+
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			wfentry & e = s->e[i];
+			uint64_t seq = ann[i].seq.load(std::memory_order_seq_cst);
+			if (seq != e.aseq.load(std::memory_order_relaxed) + 1) { continue; }
+
+			uint64_t kind = ann[i].kind.load(std::memory_order_relaxed);
+			uint64_t apos = kind, asrc = NOSRC;
+
+			if (kind == RES_PUSH) {
+				if (tail - head < size) {
+					pushers[tail - tail0] = i;
+					apos |= (tail++ << 3) | RES_OK;
+				}
+			} else {
+				if (head < tail) {
+					if (head >= tail0) { asrc = pushers[head - tail0]; }
+					apos |= (head++ << 3) | RES_OK;
+				}
+			}
+
+			e.aseq  .store(seq,     std::memory_order_relaxed);
+			e.apos  .store(apos,    std::memory_order_relaxed);
+			e.around.store(version, std::memory_order_relaxed);
+			e.asrc  .store(asrc,    std::memory_order_relaxed);
+		}
+
+		s->head   .store(head,    std::memory_order_relaxed);
+		s->tail   .store(tail,    std::memory_order_relaxed);
+		s->version.store(version, std::memory_order_relaxed);
+	};
+
+	/* announce, combine (twice at most), collect the result */
+	inline bool apply(uint64_t kind, uint64_t val, uint64_t & out)
+	{
+		uint32_t me = (uint32_t)lf_thread_index();
+		uint32_t n  = nthreads.load(std::memory_order_acquire);
+		while (n <= me) {
+			if (nthreads.compare_exchange_weak(n, me + 1)) { n = me + 1; break; }
+		}
+
+		wfannounce & a = ann[me];
+		uint64_t seq = ++a.nops;
+		a.kind.store(kind, std::memory_order_relaxed);
+		a.val .store(val,  std::memory_order_relaxed);
+		a.seq .store(seq,  std::memory_order_seq_cst);
+
+		for (int attempt = 0; attempt < 2; ++attempt)
+		{
+			uint64_t  cur  = current.load(std::memory_order_seq_cst);
+			uint32_t  idx  = ownrecord(me, cur);
+			wfstate * mine = pool + idx;
+
+			n = nthreads.load(std::memory_order_seq_cst);
+			if (!snapshot(mine, cur, n)) { continue; }
+
+			/* values of the last round must move before the next one */
+			transfer(mine, n);
+			if (mine->e[me].aseq.load(std::memory_order_relaxed) == seq) { break; }
+
+			combine(mine, n);
+			uint64_t next = (mine->version.load(std::memory_order_relaxed) << 16) | idx;
+			if (current.compare_exchange_strong(cur, next, std::memory_order_seq_cst)) {
+				transfer(mine, n); break;
+			}
+		}
+
+		/* applied by now; the round of a third party may still owe us the value */
+		wfword res = a.result.load(std::memory_order_acquire);
+		for (int help = 0; (res.tag >> 1) != seq && help < 2; ++help) {
+			uint64_t  cur  = current.load(std::memory_order_seq_cst);
+			wfstate * mine = pool + ownrecord(me, cur);
+
+			n = nthreads.load(std::memory_order_seq_cst);
+			if (snapshot(mine, cur, n)) { transfer(mine, n); }
+			res = a.result.load(std::memory_order_acquire);
+		}
+
+		out = res.val;
+		return (res.tag & 1) != 0;
+	};
+
+public:
+	/* queue of (1 << order) objects, LFMEM_* (flags) backing for the ring */
+	wfqueue(int order, int flags = 0) {
+		size   = (1ULL << order);
+		mflags = flags;
+
+		ring = static_cast<lf_atomic16<wfword> *>(lfmem_alloc(sizeof(lf_atomic16<wfword>) * size, flags));
+		if (ring == nullptr) { throw std::bad_alloc(); }
+		for (size_t i = 0; i < size; ++i) { new (ring + i) lf_atomic16<wfword>(wfword{ 0, 0 }); }
+
+		pool = static_cast<wfstate *>(lfmem_alloc(sizeof(wfstate) * 2 * LF_MAXTHREADS, 0));
+		ann  = static_cast<wfannounce *>(lfmem_alloc(sizeof(wfannounce) * LF_MAXTHREADS, 0));
+		if ((pool == nullptr) || (ann == nullptr)) { throw std::bad_alloc(); }
+
+		for (int i = 0; i < 2 * LF_MAXTHREADS; ++i) {
+			new (pool + i) wfstate();
+			for (int t = 0; t < LF_MAXTHREADS; ++t) { pool[i].e[t].around.store(~0ULL); }
+		}
+		for (int i = 0; i < LF_MAXTHREADS; ++i) {
+			new (ann + i) wfannounce();
+			ann[i].result.store(wfword{ 0, 0 });
+		}
+
+		/* record 0 holds the empty state, version 0 */
+		current.store(0);
+		nthreads.store(0);
+	};
+
+	virtual ~wfqueue() {
+		lfmem_free(ring, sizeof(lf_atomic16<wfword>) * size, mflags);
+		lfmem_free(pool, sizeof(wfstate) * 2 * LF_MAXTHREADS, 0);
+		lfmem_free(ann, sizeof(wfannounce) * LF_MAXTHREADS, 0);
+	};
+
+	inline bool isfull() {
+		const wfstate * s = record(current.load());
+		return (s->tail.load() - s->head.load()) >= size;
+	};
+
+	inline bool isempty() {
+		const wfstate * s = record(current.load());
+		return (s->tail.load() <= s->head.load());
+	};
+
+	inline size_t getsize() { return size; };
+
+	/* move the ring to NUMA (node), only for a ring mapped with (flags != 0) */
+	inline bool bind(int node) {
+		return (mflags != 0) && lfmem_bind(ring, sizeof(lf_atomic16<wfword>) * size, node);
+	};
+
+	/* push @ mutiple producers, false if full */
+	inline bool push(const T & object)
+	{
+		uint64_t unused;
+		return apply(RES_PUSH, tovalue(object), unused);
+	};
+
+	/* pop @ mutiple consumers, false if empty */
+	inline bool pop(T & object)
+	{
+		uint64_t val;
+		if (!apply(RES_POP, 0, val)) { return false; }
+		object = fromvalue(val);
+		return true;
+	};
+
+	/* pop @ mutiple consumers */
+	inline T pop()
+	{
+		T object = T(); pop(object); return object;
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
+
+#include "lfmem.hpp"
+
+#ifndef __LOCKFREE_WORK_STEALING_DEQUE_H__
+#define __LOCKFREE_WORK_STEALING_DEQUE_H__
+
+//////////////////////////////////////////////////////////////
+/* work-stealing deque (Chase & Lev 2005, Le et al. 2013)   */
+//////////////////////////////////////////////////////////////
+// One owner thread pushes and pops at the bottom, any thread
+// steals at the top. The owner's push is a store and a release
+// fence, its pop a store, one full fence and a load; only the
+// pop of the last element races the thieves with a CAS on
+// (top). A thief reads (top), fences, reads (bottom) and takes
+// the element with a CAS on (top).
+//
+// The circular array doubles when the owner finds it full. A
+// thief may still read the old array, so every replaced array
+// stays on a chain until the deque is destroyed (at most the
+// size of the current one in all).
+//
+// T is stored in std::atomic<T> (a thief may read a slot the
+// owner is rewriting), so it must be trivially copyable; task
+// pointers or indices are the intended use.
+//////////////////////////////////////////////////////////////
+template <typename T> class wsdeque
+{
+	static_assert(std::is_trivially_copyable<T>::value, "wsdeque<T>: T must be trivially copyable");
+
+	struct wsarray
+	{
+		int64_t          mask;  /* slots - 1 */
+		wsarray *        prev;  /* replaced array, freed with the deque */
+		std::atomic<T> * slot;
+
+		inline T    get(int64_t i)      { return slot[i & mask].load(std::memory_order_relaxed); };
+		inline void put(int64_t i, T x) { slot[i & mask].store(x, std::memory_order_relaxed);   };
+	};
+
+protected:
+	alignas(64) std::atomic<int64_t>   top;
+	alignas(64) std::atomic<int64_t>   bottom;
+	alignas(64) std::atomic<wsarray *> array;
+
+	int mflags;  /* LFMEM_* flags of the slots */
+
+	inline wsarray * alloc(int64_t slots, wsarray * prev)
+	{
+		wsarray * a = new wsarray;
+		a->mask = slots - 1;
+		a->prev = prev;
+		a->slot = static_cast<std::atomic<T> *>(lfmem_alloc(sizeof(std::atomic<T>) * slots, mflags));
+		if (a->slot == nullptr) { delete a; throw std::bad_alloc(); }
+
+		for (int64_t i = 0; i < slots; ++i) { new (a->slot + i) std::atomic<T>(); }
+		return a;
+	};
+
+	/* owner only: twice the slots, elements [t, b) copied */
+	inline wsarray * grow(wsarray * a, int64_t t, int64_t b)
+	{
+		wsarray * n = alloc((a->mask + 1) * 2, a);
+		for (int64_t i = t; i < b; ++i) { n->put(i, a->get(i)); }
+		array.store(n, std::memory_order_release);
+		return n;
+	};
+
+public:
+	/* (1 << order) slots to begin with; LFMEM_* (flags) backing */
+	wsdeque(int order, int flags = 0) : top(0), bottom(0), mflags(flags)
+	{
+		array.store(alloc(1LL << order, nullptr), std::memory_order_relaxed);
+	};
+
+	virtual ~wsdeque() {
+		wsarray * a = array.load();
+		while (a != nullptr) {
+			wsarray * prev = a->prev;
+			lfmem_free(a->slot, sizeof(std::atomic<T>) * (a->mask + 1), mflags);
+			delete a;
+			a = prev;
+		}
+	};
+
+	/* a snapshot, exact only for the owner with no thief running */
+	inline size_t getsize() {
+		int64_t b = bottom.load(std::memory_order_acquire);
+		int64_t t = top.load(std::memory_order_acquire);
+		return (b > t) ? (size_t)(b - t) : 0;
+	};
+	inline bool isempty() { return getsize() == 0; };
+
+	/* push @ owner, grows the array when full (std::bad_alloc if it cannot) */
+	inline void push(T x)
+	{
+		int64_t   b = bottom.load(std::memory_order_relaxed);
+		int64_t   t = top.load(std::memory_order_acquire);
+		wsarray * a = array.load(std::memory_order_relaxed);
+
+		if (b - t > a->mask) { a = grow(a, t, b); }
+		a->put(b, x);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	};
+
+	/* pop @ owner, the newest element; false if empty */
+	inline bool pop(T & x)
+	{
+		int64_t   b = bottom.load(std::memory_order_relaxed) - 1;
+		wsarray * a = array.load(std::memory_order_relaxed);
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t   t = top.load(std::memory_order_relaxed);
+
+		if (t > b) {
+			/* empty */
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		x = a->get(b);
+		if (t == b) {
+			/* the last one, a thief may be taking it too */
+			bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	};
+
+	/* steal @ any thread, the oldest element; false if empty or lost to another thread */
+	inline bool steal(T & x)
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b) { return false; }
+
+		wsarray * a = array.load(std::memory_order_acquire);
+		x = a->get(t);
+		return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	};
+};
+//////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lffifo.h"
+#include "lfmem.h"
+#include "fixedSizeMemoryLF.h"
+
+#ifdef _WIN32
+#define FSM_ALIGN_PRE   __declspec(align(64))
+#define FSM_ALIGN_POST
+#else
+#define FSM_ALIGN_PRE
+#define FSM_ALIGN_POST  __attribute__ ((aligned (64)))
+#endif
+
+/* 15 classes of 16, 256 and 4k steps, 8 of 64k steps */
+#define FSM_CLASSES     (15 + 15 + 15 + 8)
+
+/* one freelist head per cache line */
+typedef FSM_ALIGN_PRE struct fsm_list_t
+{
+   volatile lfstack_head_t head;
+   uint64_t                _pad[6];
+} FSM_ALIGN_POST fsm_list_t;
+
+/* first bytes of every mapped region, kept on fsm_regions until cleanup */
+typedef struct fsm_region_t
+{
+   lf_pointer_t link;
+   size_t       size;
+} fsm_region_t;
+
+/* in front of every slab_* block */
+typedef struct slab_head_t
+{
+   size_t size;   /* as given to mmFixedSizeMemoryAlloc */
+   size_t offs;   /* from the block start to this header (slab_memalign) */
+} slab_head_t;
+
+static fsm_list_t fsm_free[FSM_CLASSES];
+static fsm_list_t fsm_regions;
+
+/* size class of (n), FSM_CLASSES above FSM_MAXBLOCK */
+static inline size_t fsm_class(size_t n)
+{
+   if (n <= 240)          { return (n == 0) ? 0 : ((n +    15) /    16) -  1; }
+   if (n <= 3840)         { return                ((n +   255) /   256) + 14; }
+   if (n <= 61440)        { return                ((n +  4095) /  4096) + 29; }
+   if (n <= FSM_MAXBLOCK) { return                ((n + 65535) / 65536) + 44; }
+   return FSM_CLASSES;
+}
+
+static inline size_t fsm_bsize(size_t c)
+{
+   if (c < 15) { return (c +  1) *    16; }
+   if (c < 30) { return (c - 14) *   256; }
+   if (c < 45) { return (c - 29) *  4096; }
+   return               (c - 44) * 65536;
+}
+
+/* push the private chain [first .. last] with a single CAS2 */
+static void fsm_push_chain(volatile lfstack_head_t * head, lf_pointer_t * first, lf_pointer_t * last)
+{
+   lfstack_head_t orig;
+   lfstack_head_t next;
+
+   do {
+      orig.aba_ = head->aba_;
+      orig.node = head->node;
+
+      next.aba_ = orig.aba_ + 1;
+      next.node = first;
+
+      ((volatile lf_pointer_t *)(last))->node = orig.node;
+   } while (!CAS2((int64_t *)head, (int64_t *)(&orig), (int64_t *)(&next)));
+}
+
+/* class (c) ran dry: map a new region, keep its first block, free the rest */
+static void * fsm_refill(size_t c)
+{
+   size_t bsiz = fsm_bsize(c);
+   size_t offs = (bsiz >= 4096) ? 4096 : 64;
+   size_t nblk = (FSM_REFILL_BYTES / bsiz > 2) ? (FSM_REFILL_BYTES / bsiz) : 2;
+   size_t size = offs + nblk * bsiz;
+
+   unsigned char * base = (unsigned char *)lfmem_alloc(size, LFMEM_MAP);
+   if (base == NULL) { return NULL; }
+
+   fsm_region_t * region = (fsm_region_t *)base;
+   region->size = size;
+   lfstack_push_internal(&(fsm_regions.head), &(region->link));
+
+   /* link blocks 1 .. nblk-1 (nblk >= 2), block 0 goes to the caller */
+   unsigned char * blk = base + offs;
+   for (size_t i = 1; i < nblk - 1; ++i)
+   {
+      ((lf_pointer_t *)(blk + i * bsiz))->node = (lf_pointer_t *)(blk + (i + 1) * bsiz);
+   }
+   fsm_push_chain(&(fsm_free[c].head), (lf_pointer_t *)(blk + bsiz), (lf_pointer_t *)(blk + (nblk - 1) * bsiz));
+   return blk;
+}
+
+int mmFixedSizeMemoryStartup()
+{
+   for (size_t c = 0; c < FSM_CLASSES; ++c)
+   {
+      lfstack_init_internal(&(fsm_free[c].head));
+   }
+   lfstack_init_internal(&(fsm_regions.head));
+   return 0;
+}
+
+void mmFixedSizeMemoryCleanup()
+{
+   fsm_region_t * region;
+
+   for (size_t c = 0; c < FSM_CLASSES; ++c)
+   {
+      lfstack_init_internal(&(fsm_free[c].head));
+   }
+   while ((region = (fsm_region_t *)lfstack_pop_internal(&(fsm_regions.head))) != NULL)
+   {
+      lfmem_free(region, region->size, LFMEM_MAP);
+   }
+}
+
+void * mmFixedSizeMemoryAlloc(size_t nsize)
+{
+   size_t c = fsm_class(nsize);
+   if (c == FSM_CLASSES) { return lfmem_alloc(nsize, LFMEM_MAP); }
+
+   void * blk = lfstack_pop_internal(&(fsm_free[c].head));
+   return (blk != NULL) ? blk : fsm_refill(c);
+}
+
+void mmFixedSizeMemoryFree(void * buf, size_t size)
+{
+   if (buf == NULL) { return; }
+
+   size_t c = fsm_class(size);
+   if (c == FSM_CLASSES) { lfmem_free(buf, size, LFMEM_MAP); return; }
+
+   lfstack_push_internal(&(fsm_free[c].head), (lf_pointer_t *)buf);
+}
+
+size_t mmFixedSizeMemoryBlock(size_t nsize)
+{
+   size_t c = fsm_class(nsize);
+   return (c == FSM_CLASSES) ? nsize : fsm_bsize(c);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// GENERAL PURPOSE MEMORY MANAGEMENT                                         //
+///////////////////////////////////////////////////////////////////////////////
+void * slab_malloc(size_t size)
+{
+   if (size > SIZE_MAX - sizeof(slab_head_t)) { return NULL; }
+
+   slab_head_t * head = (slab_head_t *)mmFixedSizeMemoryAlloc(size + sizeof(slab_head_t));
+   if (head == NULL) { return NULL; }
+
+   head->size = size + sizeof(slab_head_t);
+   head->offs = 0;
+   return head + 1;
+}
+
+void slab_free(void * _pblk)
+{
+   if (_pblk == NULL) { return; }
+
+   slab_head_t * head = ((slab_head_t *)_pblk) - 1;
+   mmFixedSizeMemoryFree((unsigned char *)head - head->offs, head->size);
+}
+
+size_t slab_usable(void * pmem)
+{
+   slab_head_t * head = ((slab_head_t *)pmem) - 1;
+   return mmFixedSizeMemoryBlock(head->size) - sizeof(slab_head_t) - head->offs;
+}
+
+void * slab_realloc(void * pmem, size_t size)
+{
+   if (pmem == NULL) { return slab_malloc(size); }
+   if (size == 0)    { slab_free(pmem); return NULL; }
+
+   /* still fits the block, and does not waste most of it */
+   size_t used = slab_usable(pmem);
+   if ((size <= used) && (size >= used / 2)) { return pmem; }
+
+   void * pnew = slab_malloc(size);
+   if (pnew == NULL) { return NULL; }
+
+   memcpy(pnew, pmem, (size < used) ? size : used);
+   slab_free(pmem);
+   return pnew;
+}
+
+void * slab_calloc(size_t blksize, size_t numblk)
+{
+   if ((numblk != 0) && (blksize > SIZE_MAX / numblk)) { return NULL; }
+
+   void * pmem = slab_malloc(blksize * numblk);
+   if (pmem != NULL) { memset(pmem, 0, blksize * numblk); }
+   return pmem;
+}
+
+void * slab_memalign(size_t align, size_t size)
+{
+   if (align <= sizeof(slab_head_t)) { return slab_malloc(size); }
+   if ((align & (align - 1)) != 0)   { return NULL; }
+   if (size > SIZE_MAX - sizeof(slab_head_t) - align) { return NULL; }
+
+   /* room to move the header up to the next (align) boundary */
+   size_t          total = size + sizeof(slab_head_t) + align;
+   unsigned char * blk   = (unsigned char *)mmFixedSizeMemoryAlloc(total);
+   if (blk == NULL) { return NULL; }
+
+   uintptr_t     user = ((uintptr_t)(blk + sizeof(slab_head_t)) + align - 1) & ~((uintptr_t)align - 1);
+   slab_head_t * head = ((slab_head_t *)user) - 1;
+
+   head->size = total;
+   head->offs = (unsigned char *)head - blk;
+   return (void *)user;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef __FIXED_SIZE_MEMORY_LF_H__
+#define __FIXED_SIZE_MEMORY_LF_H__
+
+#include <stddef.h>
+
+///////////////////////////////////////////////////////////////////////////////
+/* lock free memory management based on fixed size memory blocks            */
+///////////////////////////////////////////////////////////////////////////////
+// Every size class is a lock-free stack of free blocks (lfstack_push_internal
+// / lfstack_pop_internal on a CAS2 head), so alloc and free are one pop / one
+// push. A class that runs dry is refilled with a fresh mapped region of about
+// FSM_REFILL_BYTES, regions are only given back by mmFixedSizeMemoryCleanup.
+//
+//        1 bytes -    240 bytes, blocks in steps of  16 bytes
+//      241 bytes -  3,840 bytes, blocks in steps of 256 bytes
+//    3,841 bytes - 61,440 bytes, blocks in steps of  4k bytes (page aligned)
+//   61,441 bytes - 524,288 bytes, blocks in steps of 64k bytes (page aligned)
+//   otherwise                  , mapped / unmapped on every call
+//
+// slab_* put a 16 byte header in front of each block, so that slab_free needs
+// no size; they are what the LD_PRELOAD shim (libslab.so, slabshim.c) maps
+// malloc / free / realloc / calloc to.
+///////////////////////////////////////////////////////////////////////////////
+#ifndef FSM_REFILL_BYTES
+#define FSM_REFILL_BYTES (64 * 1024)
+#endif
+
+#define FSM_MAXBLOCK     (524288)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+   /* ============================================================ *
+    * Memory management based on fixed size memory block           *
+    * ============================================================ */
+   // initialize library, 0 on success (optional, the lists start empty)
+   int    mmFixedSizeMemoryStartup();
+
+   // de-initialize library, every block handed out before is invalid after
+   void   mmFixedSizeMemoryCleanup();
+
+   // allocate memory, at least 16 byte aligned
+   void * mmFixedSizeMemoryAlloc(size_t nsize);
+
+   // free memory block, (size) as given to mmFixedSizeMemoryAlloc
+   void   mmFixedSizeMemoryFree (void * buf, size_t size);
+
+   // size of the block that serves (nsize), nsize itself above FSM_MAXBLOCK
+   size_t mmFixedSizeMemoryBlock(size_t nsize);
+
+   /* ============================================================== *
+    * GENERAL PURPOSE MEMORY MANAGEMENT (malloc/free/realloc/calloc) *
+    * ============================================================== */
+   void * slab_malloc  (size_t size);
+   void   slab_free    (void * _pblk);
+   void * slab_realloc (void * pmem, size_t size);
+   void * slab_calloc  (size_t blksize, size_t numblk);
+
+   // (align) a power of 2, freed with slab_free
+   void * slab_memalign(size_t align, size_t size);
+
+   // bytes usable at (pmem)
+   size_t slab_usable  (void * pmem);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
\ No newline at end of file
@@ -7,6 +7,8 @@
 #ifndef __LOCKFREE_FIFO_LIFO_H__
 #define __LOCKFREE_FIFO_LIFO_H__
 
+#include "lfmem.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -83,9 +85,6 @@ extern "C" {
 #define FAA(ptr                 ) __sync_fetch_and_add((ptr), 1) 
 #define FAS(ptr                 ) __sync_fetch_and_sub((ptr), 1) 
 
-#define _aligned_malloc(n, align) aligned_alloc((align), (n))
-#define _aligned_free(x)          free(x)
-
 #endif  // _LINUX_CAS
 #endif  // _WIN32
 
@@ -120,6 +119,7 @@ extern "C" {
     typedef lf_node_t    lfstack_node_t;
     typedef lf_pointer_t lfstack_head_t;
 
+#ifndef LFFIFO_COMPACT
     typedef struct {
         volatile lfstack_head_t worklist;
         uint64_t _d1[6];
@@ -127,10 +127,14 @@ extern "C" {
         volatile lfstack_head_t freelist;
         uint64_t _d2[6];
 
+        volatile lfstack_head_t chunks;  /* grown nodes, see lf_grow_internal */
+
         volatile size_t size;
 
         size_t          capa;
         lf_node_t *     bufa;
+        int             mflg;   /* LFMEM_* flags of bufa */
+        size_t          maxc;   /* ceiling of capa + grown nodes */
     } lfstack_t;
     //////////////////////////////////////////////////////////////
 
@@ -150,13 +154,74 @@ extern "C" {
         volatile lfstack_head_t freelist;
         uint64_t pad3[6];
 
+        volatile lfstack_head_t chunks;  /* grown nodes, see lf_grow_internal */
+
         volatile size_t size;
 
         size_t          capa;
         lf_node_t *     bufa;
+        int             mflg;   /* LFMEM_* flags of bufa */
+        size_t          maxc;   /* ceiling of capa + grown nodes */
     } lffifo_t;
     //////////////////////////////////////////////////////////////
 
+#else // LFFIFO_COMPACT
+
+    //////////////////////////////////////////////////////////////
+    /* compact links: one 64-bit word per link / head           */
+    //////////////////////////////////////////////////////////////
+    // (tag << 32) | (index + 1) of a node in bufa, 0 is NULL, so
+    // a node is 16 bytes and every CAS is a plain 64-bit one (no
+    // cmpxchg16b, any 64-bit CAS target). A 32-bit tag wraps after
+    // 2^32 operations on one head, order is at most 31; the node
+    // array is one block, *_init_grow does not grow here.
+    //////////////////////////////////////////////////////////////
+    typedef struct lf_cnode
+    {
+        volatile uint64_t link;
+        uint64_t          valu;
+    } lf_cnode_t;
+
+#define LF_LINK(index, tag)   ((((uint64_t)(tag)) << 32) | (uint64_t)(index))
+#define LF_LINK_INDEX(link)   ((uint32_t)(link))
+#define LF_LINK_TAG(link)     ((uint32_t)((link) >> 32))
+
+    typedef struct {
+        volatile uint64_t worklist;
+        uint64_t _d1[7];
+
+        volatile uint64_t freelist;
+        uint64_t _d2[7];
+
+        volatile size_t size;
+
+        size_t          capa;
+        lf_cnode_t *    bufa;
+        int             mflg;   /* LFMEM_* flags of bufa */
+        size_t          maxc;   /* == capa */
+    } lfstack_t;
+
+    typedef struct {
+        volatile uint64_t tail_;
+        uint64_t pad1[7];
+
+        volatile uint64_t head_;
+        uint64_t pad2[7];
+
+        volatile uint64_t freelist;
+        uint64_t pad3[7];
+
+        volatile size_t size;
+
+        size_t          capa;
+        lf_cnode_t *    bufa;
+        int             mflg;   /* LFMEM_* flags of bufa */
+        size_t          maxc;   /* == capa */
+    } lffifo_t;
+    //////////////////////////////////////////////////////////////
+
+#endif // LFFIFO_COMPACT
+
     ////////////////////////////////////////////////////////////////////////////
     // LIFO / STACK                                                           //
     ////////////////////////////////////////////////////////////////////////////
@@ -218,24 +283,119 @@ extern "C" {
         return (node);
     }
 
-    static inline bool lfstack_init(lfstack_t* stack, int order)
+    ////////////////////////////////////////////////////////////////////////////
+    // growable freelist: when the freelist runs dry, one more chunk of (step)
+    // nodes is allocated and pushed onto (chunks) with a CAS2, as long as
+    // (base) + the nodes already grown + (step) stays within (maxc).
+    // (chunks).node is the newest chunk, (chunks).aba_ the nodes grown so far
+    // (so it is the ABA tag as well). A chunk is (step + 1) nodes, the first
+    // one links to the previous chunk; chunks stay until lf_grow_free.
+    ////////////////////////////////////////////////////////////////////////////
+    static inline lf_pointer_t* lf_grow_internal(
+        volatile lfstack_head_t* chunks, volatile lfstack_head_t* freelist,
+        size_t base, size_t step, size_t maxc, int flags
+    )
+    {
+        lfstack_head_t orig;
+        lfstack_head_t next;
+
+        lf_node_t*    chunk = NULL;
+        lf_pointer_t* node;
+
+        do {
+            orig.aba_ = chunks->aba_;
+            orig.node = chunks->node;
+
+            /* another thread may have grown the freelist meanwhile */
+            node = lfstack_pop_internal(freelist);
+            if ((node != NULL) || (base + orig.aba_ + step > maxc)) {
+                if (chunk) { lfmem_free(chunk, sizeof(lf_node_t) * (step + 1), flags); }
+                return node;
+            }
+
+            if (chunk == NULL) {
+                chunk = (lf_node_t*)lfmem_alloc(sizeof(lf_node_t) * (step + 1), flags);
+                if (chunk == NULL) { return NULL; }
+            }
+
+            chunk->node = (lf_node_t*)(orig.node);
+            chunk->aba_ = 0;
+
+            next.node = (lf_pointer_t*)(chunk);
+            next.aba_ = orig.aba_ + step;
+
+        } while (!CAS2((int64_t*)chunks, (int64_t*)(&orig), (int64_t*)(&next)));
+
+        /* keep the first node, hand out the rest */
+        for (size_t i = 2; i <= step; ++i) {
+            lfstack_push_internal(freelist, (lf_pointer_t*)(chunk + i));
+        }
+        return (lf_pointer_t*)(chunk + 1);
+    }
+
+    static inline bool lf_grow_bind(volatile lfstack_head_t* chunks, size_t step, int node)
+    {
+        bool done = true;
+        for (lf_node_t* c = (lf_node_t*)(chunks->node); c != NULL; c = c->node) {
+            done = lfmem_bind(c, sizeof(lf_node_t) * (step + 1), node) && done;
+        }
+        return done;
+    }
+
+    static inline void lf_grow_free(volatile lfstack_head_t* chunks, size_t step, int flags)
+    {
+        lf_node_t* c = (lf_node_t*)(chunks->node);
+        while (c != NULL) {
+            lf_node_t* n = c->node;
+            lfmem_free(c, sizeof(lf_node_t) * (step + 1), flags);
+            c = n;
+        }
+        lfstack_init_internal(chunks);
+    }
+
+#ifndef LFFIFO_COMPACT
+    /* (1 << order) nodes now, growing by (1 << order) up to (1 << maxorder) */
+    static inline bool lfstack_init_grow(lfstack_t* stack, int order, int maxorder, int flags)
     {
         /* initialize work list as empty */
         lfstack_init_internal(&(stack->worklist));
 
-        /* initialize free nodes list */
+        /* initialize free nodes list, nothing grown yet */
         lfstack_init_internal(&(stack->freelist));
+        lfstack_init_internal(&(stack->chunks));
         stack->capa = (1ULL << order);
-        stack->bufa = (lf_node_t *)_aligned_malloc(sizeof(lf_node_t) * stack->capa, 64);
+        stack->mflg = flags;
+        stack->bufa = (lf_node_t *)lfmem_alloc(sizeof(lf_node_t) * stack->capa, flags);
+        if (stack->bufa == NULL) { return false; }
         for (size_t i = 0; i < stack->capa; ++i) {
             lfstack_push_internal(&(stack->freelist), (lf_pointer_t *)(stack->bufa + i));
         }
 
+        stack->maxc = (maxorder > order) ? (1ULL << maxorder) : stack->capa;
+
         /* set size to 0 */
         stack->size = 0;
         return true;
     }
 
+    static inline bool lfstack_init_ex(lfstack_t* stack, int order, int flags)
+    {
+        return lfstack_init_grow(stack, order, order, flags);
+    }
+
+    static inline bool lfstack_init(lfstack_t* stack, int order)
+    {
+        return lfstack_init_ex(stack, order, 0);
+    }
+
+    /* move the nodes to NUMA (node), only if mapped (init_ex flags != 0) */
+    static inline bool lfstack_bind(lfstack_t* stack, int node)
+    {
+        if (stack->mflg == 0) { return false; }
+        return lfmem_bind(stack->bufa, sizeof(lf_node_t) * stack->capa, node)
+            && lf_grow_bind(&(stack->chunks), stack->capa, node);
+    }
+
     static inline size_t lfstack_size(const lfstack_t* stack)
     {
         return (stack->size);
@@ -248,7 +408,7 @@ extern "C" {
 
     static inline bool lfstack_full(const lfstack_t* stack)
     {
-        return (stack->size == stack->capa);
+        return (stack->size == stack->maxc);
     }
 
     static inline bool lfstack_push(lfstack_t* stack, void* value)
@@ -257,6 +417,12 @@ extern "C" {
         // allocate a new node              //
         //////////////////////////////////////
         lfstack_node_t* node = (lfstack_node_t*)lfstack_pop_internal(&(stack->freelist));
+        if ((node == NULL) && (stack->maxc > stack->capa)) {
+            node = (lfstack_node_t*)lf_grow_internal(
+                &(stack->chunks), &(stack->freelist),
+                stack->capa, stack->capa, stack->maxc, stack->mflg
+            );
+        }
         if (node == NULL) { return false; };
 
         /* write (node) with release */
@@ -291,19 +457,24 @@ extern "C" {
 
     static inline void lfstack_free(lfstack_t* stack)
     {
-        if (stack->bufa) { _aligned_free(stack->bufa); };
+        if (stack->bufa) { lfmem_free(stack->bufa, sizeof(lf_node_t) * stack->capa, stack->mflg); };
+        lf_grow_free(&(stack->chunks), stack->capa, stack->mflg);
     }
     ////////////////////////////////////////////////////////////////////////////////////
 
     ////////////////////////////////////////////////////////////////////////////////////
     // FIFO                                                                           //
     ////////////////////////////////////////////////////////////////////////////////////
-    static inline bool lffifo_init(lffifo_t* fifo, int order)
+    /* (1 << order) - 1 nodes now, growing by (1 << order) up to (1 << maxorder) - 1 */
+    static inline bool lffifo_init_grow(lffifo_t* fifo, int order, int maxorder, int flags)
     {
-        /* setup free nodes list */
+        /* setup free nodes list, nothing grown yet */
         lfstack_init_internal(&(fifo->freelist));
+        lfstack_init_internal(&(fifo->chunks));
         fifo->capa = (1ULL << order);
-        fifo->bufa = (lf_node_t *)_aligned_malloc(sizeof(lf_node_t) * fifo->capa, 64);
+        fifo->mflg = flags;
+        fifo->bufa = (lf_node_t *)lfmem_alloc(sizeof(lf_node_t) * fifo->capa, flags);
+        if (fifo->bufa == NULL) { return false; }
         for (size_t i = 1; i < fifo->capa; ++i) {
             lfstack_push_internal(&(fifo->freelist), (lf_pointer_t *)(fifo->bufa + i));
         }
@@ -325,9 +496,29 @@ extern "C" {
 
         fifo->size = 0;
 
+        fifo->maxc = (maxorder > order) ? (1ULL << maxorder) - 1 : fifo->capa;
+
         return (true);
     }
 
+    static inline bool lffifo_init_ex(lffifo_t* fifo, int order, int flags)
+    {
+        return lffifo_init_grow(fifo, order, order, flags);
+    }
+
+    static inline bool lffifo_init(lffifo_t* fifo, int order)
+    {
+        return lffifo_init_ex(fifo, order, 0);
+    }
+
+    /* move the nodes to NUMA (node), only if mapped (init_ex flags != 0) */
+    static inline bool lffifo_bind(lffifo_t* fifo, int node)
+    {
+        if (fifo->mflg == 0) { return false; }
+        return lfmem_bind(fifo->bufa, sizeof(lf_node_t) * (fifo->capa + 1), node)
+            && lf_grow_bind(&(fifo->chunks), fifo->capa + 1, node);
+    }
+
     static inline size_t lffifo_size(const lffifo_t* fifo)
     {
         return fifo->size;
@@ -347,6 +538,12 @@ extern "C" {
     {
         /* node->next = NULL; */
         lffifo_node_t* node = (lffifo_node_t*)lfstack_pop_internal(&(fifo->freelist));
+        if ((node == NULL) && (fifo->maxc > fifo->capa)) {
+            node = (lffifo_node_t*)lf_grow_internal(
+                &(fifo->chunks), &(fifo->freelist),
+                fifo->capa, fifo->capa + 1, fifo->maxc, fifo->mflg
+            );
+        }
         if (node == NULL) { return false; };
 
         /* write (node) with release */
@@ -468,10 +665,310 @@ extern "C" {
 
     static inline void lffifo_free(lffifo_t* fifo)
     {
-        if (fifo->bufa) { _aligned_free(fifo->bufa); };
+        /* capa excludes the dummy node */
+        if (fifo->bufa) { lfmem_free(fifo->bufa, sizeof(lf_node_t) * (fifo->capa + 1), fifo->mflg); };
+        lf_grow_free(&(fifo->chunks), fifo->capa + 1, fifo->mflg);
+    }
+    ////////////////////////////////////////////////////////////////////////////////////
+
+#else // LFFIFO_COMPACT
+
+    static inline bool lf_cas64(volatile uint64_t* ptr, uint64_t oldval, uint64_t newval)
+    {
+#ifdef _WIN32
+        return _InterlockedCompareExchange64((volatile __int64*)ptr, (__int64)newval, (__int64)oldval) == (__int64)oldval;
+#else
+        return __sync_bool_compare_and_swap(ptr, oldval, newval);
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // LIFO / STACK (compact)                                                 //
+    ////////////////////////////////////////////////////////////////////////////
+    static inline void lfstack_push_compact(volatile uint64_t* head, lf_cnode_t* bufa, uint32_t index)
+    {
+        uint64_t orig;
+        uint64_t next;
+
+        do {
+            orig = *head;
+            next = LF_LINK(index, LF_LINK_TAG(orig) + 1);
+
+            /* write (node) with release */
+            bufa[index - 1].link = LF_LINK(LF_LINK_INDEX(orig), LF_LINK_TAG(next));
+
+        } while (!lf_cas64(head, orig, next));
+    }
+
+    /* index + 1 of the node taken, 0 if empty */
+    static inline uint32_t lfstack_pop_compact(volatile uint64_t* head, lf_cnode_t* bufa)
+    {
+        uint64_t orig;
+        uint64_t next;
+        uint32_t index;
+
+        do {
+            orig  = *head;
+            index = LF_LINK_INDEX(orig);
+            if (index == 0) {
+                return 0;
+            }
+
+            /* load (node) with acquire */
+            next = LF_LINK(LF_LINK_INDEX(bufa[index - 1].link), LF_LINK_TAG(orig) + 1);
+
+        } while (!lf_cas64(head, orig, next));
+
+        return index;
+    }
+
+    /* (1 << order) nodes, maxorder is ignored (no growth with compact links) */
+    static inline bool lfstack_init_grow(lfstack_t* stack, int order, int maxorder, int flags)
+    {
+        if (order > 31) { return false; }
+
+        /* initialize work list and free nodes list */
+        stack->worklist = 0;
+        stack->freelist = 0;
+        stack->capa = (1ULL << order);
+        stack->maxc = stack->capa;
+        stack->mflg = flags;
+        stack->bufa = (lf_cnode_t *)lfmem_alloc(sizeof(lf_cnode_t) * stack->capa, flags);
+        if (stack->bufa == NULL) { return false; }
+        for (size_t i = 0; i < stack->capa; ++i) {
+            lfstack_push_compact(&(stack->freelist), stack->bufa, (uint32_t)(i + 1));
+        }
+
+        /* set size to 0 */
+        stack->size = 0;
+        return true;
+    }
+
+    static inline bool lfstack_init_ex(lfstack_t* stack, int order, int flags)
+    {
+        return lfstack_init_grow(stack, order, order, flags);
+    }
+
+    static inline bool lfstack_init(lfstack_t* stack, int order)
+    {
+        return lfstack_init_ex(stack, order, 0);
+    }
+
+    /* move the nodes to NUMA (node), only if mapped (init_ex flags != 0) */
+    static inline bool lfstack_bind(lfstack_t* stack, int node)
+    {
+        if (stack->mflg == 0) { return false; }
+        return lfmem_bind(stack->bufa, sizeof(lf_cnode_t) * stack->capa, node);
+    }
+
+    static inline size_t lfstack_size(const lfstack_t* stack)
+    {
+        return (stack->size);
+    }
+
+    static inline bool lfstack_empty(const lfstack_t* stack)
+    {
+        return (stack->size == 0);
+    }
+
+    static inline bool lfstack_full(const lfstack_t* stack)
+    {
+        return (stack->size == stack->maxc);
+    }
+
+    static inline bool lfstack_push(lfstack_t* stack, void* value)
+    {
+        uint32_t index = lfstack_pop_compact(&(stack->freelist), stack->bufa);
+        if (index == 0) { return false; };
+
+        /* write (node) with release */
+        stack->bufa[index - 1].valu = (uint64_t)value;
+
+        /* push into working list */
+        lfstack_push_compact(&(stack->worklist), stack->bufa, index);
+
+        /* increament counter */
+        FAA(&(stack->size));
+
+        return (true);
+    }
+
+    static inline void* lfstack_pop(lfstack_t* stack)
+    {
+        uint32_t index = lfstack_pop_compact(&(stack->worklist), stack->bufa);
+        if (index == 0) { return NULL; };
+
+        /* load (node) with acquire */
+        uint64_t value = stack->bufa[index - 1].valu;
+
+        /* free the node */
+        lfstack_push_compact(&(stack->freelist), stack->bufa, index);
+
+        /* decreament counter */
+        FAS(&(stack->size));
+
+        return ((void*)value);
+    }
+
+    static inline void lfstack_free(lfstack_t* stack)
+    {
+        if (stack->bufa) { lfmem_free(stack->bufa, sizeof(lf_cnode_t) * stack->capa, stack->mflg); };
+    }
+    ////////////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////////////
+    // FIFO (compact)                                                                 //
+    ////////////////////////////////////////////////////////////////////////////////////
+
+    /* (1 << order) - 1 nodes, maxorder is ignored (no growth with compact links) */
+    static inline bool lffifo_init_grow(lffifo_t* fifo, int order, int maxorder, int flags)
+    {
+        if (order > 31) { return false; }
+
+        /* setup free nodes list, node 1 is the first dummy */
+        fifo->freelist = 0;
+        fifo->capa = (1ULL << order);
+        fifo->mflg = flags;
+        fifo->bufa = (lf_cnode_t *)lfmem_alloc(sizeof(lf_cnode_t) * fifo->capa, flags);
+        if (fifo->bufa == NULL) { return false; }
+        for (size_t i = 1; i < fifo->capa; ++i) {
+            lfstack_push_compact(&(fifo->freelist), fifo->bufa, (uint32_t)(i + 1));
+        }
+        fifo->capa -= 1;
+        fifo->maxc  = fifo->capa;
+
+        /* initialize fifo control block */
+        fifo->bufa[0].link = 0;
+        fifo->bufa[0].valu = 0;
+
+        fifo->head_ = LF_LINK(1, 0);
+        fifo->tail_ = LF_LINK(1, 0);
+
+        fifo->size = 0;
+
+        return (true);
+    }
+
+    static inline bool lffifo_init_ex(lffifo_t* fifo, int order, int flags)
+    {
+        return lffifo_init_grow(fifo, order, order, flags);
+    }
+
+    static inline bool lffifo_init(lffifo_t* fifo, int order)
+    {
+        return lffifo_init_ex(fifo, order, 0);
+    }
+
+    /* move the nodes to NUMA (node), only if mapped (init_ex flags != 0) */
+    static inline bool lffifo_bind(lffifo_t* fifo, int node)
+    {
+        if (fifo->mflg == 0) { return false; }
+        return lfmem_bind(fifo->bufa, sizeof(lf_cnode_t) * (fifo->capa + 1), node);
+    }
+
+    static inline size_t lffifo_size(const lffifo_t* fifo)
+    {
+        return fifo->size;
+    }
+
+    static inline bool lffifo_empty(const lffifo_t* fifo)
+    {
+        return (fifo->size == 0);
+    }
+
+    static inline bool lffifo_full(const lffifo_t* fifo)
+    {
+        return false;
+    }
+
+    static inline bool lffifo_push(lffifo_t* fifo, void* value)
+    {
+        lf_cnode_t* bufa  = fifo->bufa;
+        uint32_t    index = lfstack_pop_compact(&(fifo->freelist), bufa);
+        if (index == 0) { return false; };
+
+        /* write (node) with release, keep its tag */
+        bufa[index - 1].valu = (uint64_t)(value);
+        bufa[index - 1].link = LF_LINK(0, LF_LINK_TAG(bufa[index - 1].link));
+
+        uint64_t tail, next;
+        while (1)
+        {
+            tail = fifo->tail_;
+            next = bufa[LF_LINK_INDEX(tail) - 1].link;
+
+            if (tail == fifo->tail_)
+            {
+                if (LF_LINK_INDEX(next) == 0) {
+                    if (lf_cas64(&(bufa[LF_LINK_INDEX(tail) - 1].link), next, LF_LINK(index, LF_LINK_TAG(next) + 1))) {
+                        break;  // Enqueue done!
+                    }
+                }
+                else {
+                    lf_cas64(&(fifo->tail_), tail, LF_LINK(LF_LINK_INDEX(next), LF_LINK_TAG(tail) + 1));
+                }
+            }
+        }
+
+        lf_cas64(&(fifo->tail_), tail, LF_LINK(index, LF_LINK_TAG(tail) + 1));
+
+        /* increament counter */
+        FAA(&(fifo->size));
+
+        return true;
+    };
+
+    static inline void* lffifo_pop(lffifo_t* fifo)
+    {
+        lf_cnode_t* bufa = fifo->bufa;
+        uint64_t    valu;
+        uint64_t    tail, head, next;
+
+        while (1)
+        {
+            head = fifo->head_;
+            tail = fifo->tail_;
+            next = bufa[LF_LINK_INDEX(head) - 1].link;
+
+            if (head == fifo->head_)
+            {
+                if (LF_LINK_INDEX(head) == LF_LINK_INDEX(tail)) {
+
+                    /* queue empty (?) */
+                    if (LF_LINK_INDEX(next) == 0) {
+                        return  NULL;
+                    }
+
+                    lf_cas64(&(fifo->tail_), tail, LF_LINK(LF_LINK_INDEX(next), LF_LINK_TAG(tail) + 1));
+                }
+                else {
+                    /* copy valu */
+                    valu = bufa[LF_LINK_INDEX(next) - 1].valu;
+
+                    if (lf_cas64(&(fifo->head_), head, LF_LINK(LF_LINK_INDEX(next), LF_LINK_TAG(head) + 1))) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        /* decreament counter */
+        FAS(&(fifo->size));
+
+        /* free the memory */
+        lfstack_push_compact(&(fifo->freelist), bufa, LF_LINK_INDEX(head));
+        return ((void*)valu);
+    };
+
+    static inline void lffifo_free(lffifo_t* fifo)
+    {
+        /* capa excludes the dummy node */
+        if (fifo->bufa) { lfmem_free(fifo->bufa, sizeof(lf_cnode_t) * (fifo->capa + 1), fifo->mflg); };
     }
     ////////////////////////////////////////////////////////////////////////////////////
 
+#endif // LFFIFO_COMPACT
+
 #ifdef __cplusplus
 };
 #endif
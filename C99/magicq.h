@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "lfmem.h"
 #include "mirrorbuf.h"
 
 #ifndef __MAGICQ_SPSC_H__
@@ -14,23 +15,42 @@
       volatile uint32_t head;                                           \
       volatile uint32_t tail;                                           \
                                                                         \
-               type *   data;                                           \
+      intptr_t offs;  /* data, relative to this header */               \
+      uint64_t magic; /* set once a shared header is ready */           \
                                                                         \
       mirrorbuf_t mbuf;                                                 \
    } name##_t;
 
+#define MAGICQ_DATA(name, type)                                         \
+   /* the ring is addressed relative to the header, so that the     */  \
+   /* header and ring can live in a shared mapping placed at a      */  \
+   /* different address in every process.                           */  \
+   static inline type * name##_data(const name##_t * cb)                \
+   {                                                                    \
+      return (type *)((intptr_t)cb + cb->offs);                         \
+   };
+
 #define MAGICQ_INIT(name, type)                                         \
-   static inline bool name##_init(name##_t * cb, int order)             \
+   static inline bool name##_init_ex(                                   \
+      name##_t * cb, int order, int flags                               \
+      )                                                                 \
    {                                                                    \
       cb->size = (1UL << order);                                        \
       cb->vsiz = (2UL << order);                                        \
       cb->head = 0;                                                     \
       cb->tail = 0;                                                     \
+      cb->magic = 0;                                                    \
                                                                         \
-      cb->data = (type *)mirrorbuf_create(                              \
-         &(cb->mbuf), cb->size * sizeof(type)                           \
+      type * data = (type *)mirrorbuf_create_ex(                        \
+         &(cb->mbuf), cb->size * sizeof(type), flags                    \
          );                                                             \
-      return (cb->data != NULL);                                        \
+      cb->offs = (intptr_t)data - (intptr_t)cb;                         \
+      return (data != NULL);                                            \
+   };                                                                   \
+                                                                        \
+   static inline bool name##_init(name##_t * cb, int order)             \
+   {                                                                    \
+      return name##_init_ex(cb, order, 0);                              \
    };
 
 #define MAGICQ_FREE(name)                                               \
@@ -39,6 +59,15 @@
       mirrorbuf_destroy(&(cb->mbuf));                                   \
    };
 
+#define MAGICQ_BIND(name, type)                                         \
+   /* set NUMA (node) of the ring, e.g. lfmem_current_node() of the  */ \
+   /* consumer; pages of a mirrored ring are not migrated once used, */ \
+   /* so bind before the first push (or pass LFMEM_NODE() to init).  */ \
+   static inline bool name##_bind(name##_t * cb, int node)              \
+   {                                                                    \
+      return lfmem_bind(name##_data(cb), cb->size * sizeof(type), node);\
+   };
+
 #define MAGICQ_FULL(name)                                               \
    static inline bool name##_full(const name##_t * cb)                  \
    {                                                                    \
@@ -54,7 +83,7 @@
 #define MAGICQ_TOP(name, type, copyfunc)                                \
    static inline bool name##_top(const name##_t * cb, type * pobj)      \
    {                                                                    \
-      copyfunc(&cb->data[cb->head], pobj);                              \
+      copyfunc(&(name##_data(cb)[cb->head]), pobj);                     \
       return true;                                                      \
    };
 
@@ -71,7 +100,7 @@
    {                                                                    \
       if (name##_full(cb)) { return false; };                           \
                                                                         \
-      copyfunc(data, &(cb->data[cb->tail]));                            \
+      copyfunc(data, &(name##_data(cb)[cb->tail]));                     \
       cb->tail = (cb->tail + 1) & (cb->vsiz - 1);                       \
                                                                         \
       return true;                                                      \
@@ -82,20 +111,97 @@
    {                                                                    \
       if (name##_empty(cb)) { return false; };                          \
                                                                         \
-      copyfunc(&(cb->data[cb->head]), data);                            \
+      copyfunc(&(name##_data(cb)[cb->head]), data);                     \
       cb->head = (cb->head + 1) & (cb->vsiz - 1);                       \
                                                                         \
       return true;                                                      \
    };
 
+#ifdef _WIN32
+#include <intrin.h>
+#define MAGICQ_FENCE()   _ReadWriteBarrier()
+#else
+#define MAGICQ_FENCE()   __sync_synchronize()
+#endif
+
+#define MAGICQ_SHM_MAGIC (0x31304d485351474dULL) /* "MGQSHM01" */
+
+#define MAGICQ_SHM(name, type)                                          \
+   /* per process handle of a named shared magicq, the header and    */ \
+   /* the ring live in the mapping: [name##_t][ring][ring mirror],   */ \
+   /* the mbuf member of the shared header itself is left unused.    */ \
+   typedef struct name##_shm_t                                          \
+   {                                                                    \
+      name##_t *  cb;                                                   \
+      mirrorbuf_t mbuf;                                                 \
+   } name##_shm_t;                                                      \
+                                                                        \
+   static inline name##_t * name##_shm_create(                          \
+      name##_shm_t * shm, const char * path, int order                  \
+      )                                                                 \
+   {                                                                    \
+      shm->cb = (name##_t *)mirrorbuf_create_shared(                    \
+         &(shm->mbuf), path,                                            \
+         sizeof(name##_t), (1UL << order) * sizeof(type)                \
+         );                                                             \
+      if (shm->cb == NULL) { return NULL; }                             \
+                                                                        \
+      /* fresh pages are zero: head, tail */                            \
+      shm->cb->size = (1UL << order);                                   \
+      shm->cb->vsiz = (2UL << order);                                   \
+      shm->cb->offs = (intptr_t)shm->mbuf.hsiz;                         \
+                                                                        \
+      /* publish the header last */                                     \
+      MAGICQ_FENCE();                                                   \
+      shm->cb->magic = MAGICQ_SHM_MAGIC;                                \
+      return shm->cb;                                                   \
+   };                                                                   \
+                                                                        \
+   static inline name##_t * name##_shm_attach(                          \
+      name##_shm_t * shm, const char * path                             \
+      )                                                                 \
+   {                                                                    \
+      shm->cb = (name##_t *)mirrorbuf_attach_shared(                    \
+         &(shm->mbuf), path, sizeof(name##_t)                           \
+         );                                                             \
+      if (shm->cb == NULL) { return NULL; }                             \
+                                                                        \
+      /* not ready yet, or built for another type */                    \
+      if ((shm->cb->magic != MAGICQ_SHM_MAGIC) ||                       \
+          (shm->cb->size * sizeof(type) != shm->mbuf.bsiz))             \
+      {                                                                 \
+         mirrorbuf_destroy(&(shm->mbuf));                               \
+         return (shm->cb = NULL);                                       \
+      }                                                                 \
+      MAGICQ_FENCE();                                                   \
+      return shm->cb;                                                   \
+   };                                                                   \
+                                                                        \
+   static inline void name##_shm_detach(name##_shm_t * shm)             \
+   {                                                                    \
+      mirrorbuf_destroy(&(shm->mbuf));                                  \
+      shm->cb = NULL;                                                   \
+   };                                                                   \
+                                                                        \
+   static inline int name##_shm_unlink(const char * path)               \
+   {                                                                    \
+      return mirrorbuf_unlink_shared(path);                             \
+   };
+
 #define MAGICQ_PROTOTYPE(name, type, copyfunc)                          \
    MAGICQ_TYPE(name, type);                                             \
+   MAGICQ_DATA(name, type);                                             \
    MAGICQ_INIT(name, type);                                             \
    MAGICQ_FREE(name      );                                             \
+   MAGICQ_BIND(name, type);                                             \
    MAGICQ_FULL(name      );                                             \
    MAGICQ_EMPT(name      );                                             \
    MAGICQ_SIZE(name      );                                             \
    MAGICQ_PUSH(name, type, copyfunc);                                   \
    MAGICQ_POP (name, type, copyfunc);
 
+/* named shared memory magicq, use next to MAGICQ_PROTOTYPE(name, ...) */
+#define MAGICQ_SHM_PROTOTYPE(name, type)                                \
+   MAGICQ_SHM(name, type);
+
 #endif
\ No newline at end of file
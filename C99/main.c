@@ -21,8 +21,12 @@ static inline int sleep(int sec)
    MODE 1: MPMC RING BUFFER QUEUE
    MODE 2: LOCK FREE STACK
    MODE 3: LOCK FREE FIFO (MSQUE)
+   MODE 4: SPSC MESSAGE RING (MSGRING)
 */
 #define TESTMODE     1
+#define DENSE        0   /* MODE 1: RBQ_PROTOTYPE_DENSE nodes */
+#define GROW         0   /* MODE 2/3: 1 << 10 nodes, growing up to 1 << 16 */
+#define COMPACT      0   /* MODE 2/3: 32-bit index + tag links, 64-bit CAS */
 #define MAXTHREADS   8
 #define MAXITER      8
 
@@ -56,9 +60,12 @@ typedef magicq_t pile;
 #include "rbq.h"
 
 #define copyu64(from, to) (((to)[0]) = ((from)[0]))
-#define sched_yield_(a) sched_yield()
 
-RBQ_PROTOTYPE(rbq, uint64_t, copyu64, sched_yield_);
+#if (DENSE)
+RBQ_PROTOTYPE_DENSE(rbq, uint64_t, copyu64, rbq_yield);
+#else
+RBQ_PROTOTYPE(rbq, uint64_t, copyu64, rbq_yield);
+#endif
 static inline uint64_t _rbq_pop(rbq_t * f) {uint64_t val = 0ULL; rbq_pop(f, &val); return val;}
 
 typedef rbq_t pile;
@@ -72,11 +79,18 @@ typedef rbq_t pile;
 #define SIZE(f)      rbq_size(f)
 
 #elif (TESTMODE == 2)
+#if (COMPACT)
+#define LFFIFO_COMPACT
+#endif
 #include "lffifo.h"
 
 #define pile lfstack_t
 
+#if (GROW)
+#define INIT(f)      lfstack_init_grow((f), 10, 16, 0)
+#else
 #define INIT(f)      lfstack_init((f), 16)
+#endif
 #define FREE(f)      lfstack_free((f))
 
 #define PUSH(f, val) lfstack_push((f), ((void *)(val)))
@@ -84,19 +98,48 @@ typedef rbq_t pile;
 
 #define SIZE(f)      lfstack_size(f)
 #elif (TESTMODE == 3)
+#if (COMPACT)
+#define LFFIFO_COMPACT
+#endif
 #include "lffifo.h"
 
 #define pile lffifo_t
 
+#if (GROW)
+#define INIT(f)      lffifo_init_grow((f), 10, 16, 0)
+#else
 #define INIT(f)      lffifo_init((f), 16)
+#endif
 #define FREE(f)      lffifo_free((f))
 
 #define PUSH(f, val) lffifo_push((f), ((void *)(val)))
 #define POP(f)       lffifo_pop(f)
 
 #define SIZE(f)      lffifo_size(f)
+#elif (TESTMODE == 4)
+#include "msgring.h"
+
+static inline uint64_t _msgring_pop(msgring_t * f)
+{
+   uint64_t val = 0ULL; size_t len; const void * p = msgring_peek(f, &len);
+   if (p) { val = *(const uint64_t *)p; msgring_release(f); }
+   return val;
+}
+
+typedef msgring_t pile;
+
+#define INIT(f)      msgring_init((f), 20)
+#define FREE(f)      msgring_free((f))
+
+#define PUSH(f, val) msgring_push((f), &(val), sizeof(val))
+#define POP(f)       _msgring_pop(f)
+
+#define SIZE(f)      msgring_size(f)
 #endif
 
+/* single producer single consumer modes */
+#define SPSCMODE     ((TESTMODE == 0) || (TESTMODE == 4))
+
 /*
 *  Global variables
 */
@@ -248,7 +291,7 @@ void bench (int max)
          bridge_c[i].duration = 0;
 
          bridge_h[i].limit    = LIMIT;
-         bridge_h[i].stopped  = (TESTMODE == 0) ? 1 : 0;
+         bridge_h[i].stopped  = (SPSCMODE) ? 1 : 0;
          bridge_h[i].duration = 0;
 
 #ifdef _WIN32         
@@ -270,7 +313,7 @@ void bench (int max)
             &(fils[i])
          );
 
-         #if (TESTMODE != 0)
+         #if (!SPSCMODE)
          CreateThread(
             NULL,
             0L,
@@ -295,7 +338,7 @@ void bench (int max)
             &bridge_c[i]
          );
 
-         #if (TESTMODE != 0)
+         #if (!SPSCMODE)
          pthread_create(
             &fils[i], 
             NULL,
@@ -355,8 +398,10 @@ int main()
    printf("\n-------- Lock free queue (MSQ) bench ----------\n");
 #elif (TESTMODE == 3)
    printf("\n-------- Lock free stack bench ----------\n");
+#elif (TESTMODE == 4)
+   printf("\n-------- Message ring (SPSC) bench ----------\n");
 #endif
 
-   bench ((TESTMODE == 0) ? (1) : MAXTHREADS);
+   bench ((SPSCMODE) ? (1) : MAXTHREADS);
    return 0;
 }
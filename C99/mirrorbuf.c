@@ -21,6 +21,7 @@ void mirrorbuf_destroy(mirrorbuf_t * map)
 void * mirrorbuf_create(mirrorbuf_t * map, size_t bsiz)
 {
    map->mapf = map->pbuf = NULL;
+   map->hsiz = 0;
 
    // is ring_size a multiple of 64k? if not, this won't ever work!
    if ((bsiz & 0xffff) != 0)
@@ -66,11 +67,44 @@ void * mirrorbuf_create(mirrorbuf_t * map, size_t bsiz)
    return ((void *)pBuf);
 }
 
+/* no large page file mappings here, flags are ignored */
+void * mirrorbuf_create_ex(mirrorbuf_t * map, size_t bsiz, int flags)
+{
+   return mirrorbuf_create(map, bsiz);
+}
+
+/* named shared rings are not supported on windows yet */
+void * mirrorbuf_create_shared(mirrorbuf_t * map, const char * name, size_t hsiz, size_t bsiz)
+{
+   map->mapf = map->pbuf = NULL;
+   return (NULL);
+}
+
+void * mirrorbuf_attach_shared(mirrorbuf_t * map, const char * name, size_t hsiz)
+{
+   map->mapf = map->pbuf = NULL;
+   return (NULL);
+}
+
+int mirrorbuf_unlink_shared(const char * name)
+{
+   return (-1);
+}
+
 #else
 #include <stdlib.h>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#ifndef MFD_HUGETLB
+#  define MFD_HUGETLB 0x0004U
+#endif
+#endif
+
+#include "lfmem.h"
 #include "mirrorbuf.h"
 
 /** OSX needs some help here */
@@ -78,14 +112,92 @@ void * mirrorbuf_create(mirrorbuf_t * map, size_t bsiz)
 #  define MAP_ANONYMOUS MAP_ANON
 #endif
 
+static size_t mirrorbuf_pagealign(size_t n)
+{
+   size_t page = (size_t)sysconf(_SC_PAGESIZE);
+   return ((n + page - 1) / page) * page;
+}
+
+/* map [hsiz header][bsiz ring] of (fd), then the ring once more right after it, */
+/* at an (align) boundary with extra mmap (flags)                                */
+static void * mirrorbuf_map(mirrorbuf_t * map, int fd, size_t hsiz, size_t bsiz, int flags, size_t align)
+{
+   unsigned char * addr;
+   unsigned char * data;
+   size_t          slack;
+
+   /* reserve the address range, with room to align it */
+   addr = (unsigned char *)mmap(
+      NULL,
+      hsiz + (bsiz << 1) + align,
+      PROT_NONE,
+      MAP_ANONYMOUS | MAP_PRIVATE,
+      -1,
+      0
+   );
+   if (addr == MAP_FAILED)
+   {
+      return (NULL);
+   }
+
+   data = addr;
+   if (align)
+   {
+      /* give back what is not needed around the aligned range */
+      data  = (unsigned char *)((((uintptr_t)addr) + align - 1) & ~((uintptr_t)align - 1));
+      slack = (size_t)(data - addr);
+      if (slack)
+      {
+         munmap(addr, slack);
+      }
+      if (align - slack)
+      {
+         munmap(data + hsiz + (bsiz << 1), align - slack);
+      }
+   }
+
+   addr = (unsigned char *)mmap(
+      data,
+      hsiz + bsiz,
+      PROT_READ | PROT_WRITE,
+      MAP_FIXED | MAP_SHARED | flags,
+      fd,
+      0
+   );
+   if (addr != data)
+   {
+      munmap(data, hsiz + (bsiz << 1));
+      return (NULL);
+   }
+
+   addr = (unsigned char *)mmap(
+      data + hsiz + bsiz,
+      bsiz,
+      PROT_READ | PROT_WRITE,
+      MAP_FIXED | MAP_SHARED | flags,
+      fd,
+      hsiz
+   );
+   if (addr != (data + hsiz + bsiz))
+   {
+      munmap(data, hsiz + (bsiz << 1));
+      return (NULL);
+   }
+
+   map->pbuf = data;
+   map->hsiz = hsiz;
+   map->bsiz = bsiz;
+   return ((void *)data);
+}
+
 void * mirrorbuf_create(mirrorbuf_t * map, size_t bsiz)
 {
    char path[] = "/tmp/SPSC-XXXXXX";
    int fd, status;
-   unsigned char * addr;
-   unsigned char * data;
+   void * data;
 
    map->pbuf = NULL;
+   map->hsiz = 0;
 
    fd = mkstemp(path);
    if (fd < 0)
@@ -96,71 +208,193 @@ void * mirrorbuf_create(mirrorbuf_t * map, size_t bsiz)
    status = unlink(path);
    if (status)
    {
+      close(fd);
       return (NULL);
    }
 
    status = ftruncate(fd, bsiz);
    if (status)
    {
+      close(fd);
       return (NULL);
    }
 
    /* create the array of data */
-   data = (unsigned char *)mmap(
-      NULL,
-      bsiz << 1,
-      PROT_NONE,
-      MAP_ANONYMOUS | MAP_PRIVATE,
-      -1,
-      0
-   );
-   if (data == MAP_FAILED)
+   data = mirrorbuf_map(map, fd, 0, bsiz, 0, 0);
+
+   close(fd);
+   return (data);
+}
+
+void * mirrorbuf_create_ex(mirrorbuf_t * map, size_t bsiz, int flags)
+{
+   void * data = NULL;
+   int    node = LFMEM_NODEOF(flags);
+   int    pop  = 0;
+
+   if (flags == 0)
+   {
+      return mirrorbuf_create(map, bsiz);
+   }
+
+#ifdef MAP_POPULATE
+   /* with a node, pages are faulted in only once the policy is set */
+   if ((flags & LFMEM_POPULATE) && (node < 0))
+   {
+      pop = MAP_POPULATE;
+   }
+#endif
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+   map->pbuf = NULL;
+   map->hsiz = 0;
+
+   /* hugetlbfs backed ring, mapped at a huge page boundary */
+   if ((flags & LFMEM_HUGEPAGE) && ((bsiz % LFMEM_HUGESIZE) == 0))
+   {
+      int fd = (int)syscall(SYS_memfd_create, "mirrorbuf", MFD_HUGETLB);
+      if (fd >= 0)
+      {
+         if (ftruncate(fd, bsiz) == 0)
+         {
+            data = mirrorbuf_map(map, fd, 0, bsiz, pop, LFMEM_HUGESIZE);
+         }
+         close(fd);
+      }
+   }
+
+   /* shmem (mbind-able), asking for transparent huge pages if wanted */
+   if (data == NULL)
+   {
+      int fd = (int)syscall(SYS_memfd_create, "mirrorbuf", 0);
+      if (fd >= 0)
+      {
+         if (flags & LFMEM_HUGEPAGE)
+         {
+            pop = 0;
+         }
+         if (ftruncate(fd, bsiz) == 0)
+         {
+            data = mirrorbuf_map(map, fd, 0, bsiz, pop, (flags & LFMEM_HUGEPAGE) ? LFMEM_HUGESIZE : 0);
+#ifdef MADV_HUGEPAGE
+            if ((data != NULL) && (flags & LFMEM_HUGEPAGE))
+            {
+               madvise(data, bsiz << 1, MADV_HUGEPAGE);
+            }
+#endif
+         }
+         close(fd);
+      }
+   }
+#endif
+
+   /* plain tmpfile pages */
+   if (data == NULL)
+   {
+      data = mirrorbuf_create(map, bsiz);
+      pop  = 0;
+   }
+   if (data == NULL)
    {
       return (NULL);
    }
 
-   addr = (unsigned char *)mmap(
-      data,
-      bsiz,
-      PROT_READ | PROT_WRITE,
-      MAP_FIXED | MAP_SHARED,
-      fd,
-      0
-   );
-   if (addr != data)
+   /* shared policy of the pages, covers both views */
+   if (node >= 0)
+   {
+      lfmem_bind(data, bsiz, node);
+   }
+   if ((flags & LFMEM_POPULATE) && (pop == 0))
+   {
+      lfmem_touch(data, bsiz);
+   }
+   if (flags & LFMEM_LOCK)
+   {
+      mlock(data, bsiz << 1);
+   }
+   return (data);
+}
+
+void * mirrorbuf_create_shared(mirrorbuf_t * map, const char * name, size_t hsiz, size_t bsiz)
+{
+   int fd, status;
+   void * data;
+
+   map->pbuf = NULL;
+   map->hsiz = 0;
+
+   hsiz = mirrorbuf_pagealign(hsiz);
+   if ((bsiz == 0) || (bsiz != mirrorbuf_pagealign(bsiz)))
    {
       return (NULL);
    }
 
-   addr = (unsigned char *)mmap(
-      data + bsiz,
-      bsiz,
-      PROT_READ | PROT_WRITE,
-      MAP_FIXED | MAP_SHARED,
-      fd,
-      0
-   );
-   if (addr != (data + bsiz))
+   /* exclusive: a stale ring of the same name must be unlinked first */
+   fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+   if (fd < 0)
    {
       return (NULL);
    }
 
-   status = close(fd);
+   /* new pages read as zero */
+   status = ftruncate(fd, hsiz + bsiz);
    if (status)
    {
+      close(fd);
+      shm_unlink(name);
       return (NULL);
    }
 
-   map->pbuf = data;
-   map->bsiz = bsiz;
-   return ((void *)data);
+   data = mirrorbuf_map(map, fd, hsiz, bsiz, 0, 0);
+   if (data == NULL)
+   {
+      shm_unlink(name);
+   }
+
+   close(fd);
+   return (data);
+}
+
+void * mirrorbuf_attach_shared(mirrorbuf_t * map, const char * name, size_t hsiz)
+{
+   struct stat st;
+   int fd;
+   void * data;
+
+   map->pbuf = NULL;
+   map->hsiz = 0;
+
+   hsiz = mirrorbuf_pagealign(hsiz);
+
+   fd = shm_open(name, O_RDWR, 0);
+   if (fd < 0)
+   {
+      return (NULL);
+   }
+
+   /* ring size is whatever the creator made it */
+   if ((fstat(fd, &st) != 0) || ((size_t)st.st_size <= hsiz))
+   {
+      close(fd);
+      return (NULL);
+   }
+
+   data = mirrorbuf_map(map, fd, hsiz, (size_t)st.st_size - hsiz, 0, 0);
+
+   close(fd);
+   return (data);
+}
+
+int mirrorbuf_unlink_shared(const char * name)
+{
+   return shm_unlink(name);
 }
 
 void mirrorbuf_destroy(mirrorbuf_t * map)
 {
    if (map->pbuf)
    {
-      munmap(map->pbuf, map->bsiz);
+      munmap(map->pbuf, map->hsiz + (map->bsiz << 1));
    }
    map->pbuf = NULL;
 }
@@ -7,6 +7,7 @@ typedef struct mirrorbuf_t
 {
    HANDLE          mapf;
    unsigned char * pbuf;
+   size_t          hsiz;
    size_t          bsiz;
 } mirrorbuf_t;
 
@@ -15,6 +16,7 @@ typedef struct mirrorbuf_t
 typedef struct mirrorbuf_t
 {
    unsigned char * pbuf;
+   size_t          hsiz;
    size_t          bsiz;
 } mirrorbuf_t;
 
@@ -27,6 +29,16 @@ extern "C" {
    void   mirrorbuf_destroy(mirrorbuf_t * map             );
    void * mirrorbuf_create (mirrorbuf_t * map, size_t bsiz);
 
+   /* same with LFMEM_* backing flags (huge pages, prefault, mlock), */
+   /* falls back to mirrorbuf_create when an option is unavailable   */
+   void * mirrorbuf_create_ex(mirrorbuf_t * map, size_t bsiz, int flags);
+
+   /* named shared memory: [hsiz header][bsiz ring][bsiz ring mirror]   */
+   /* hsiz is rounded up to the page size, the ring starts at pbuf+hsiz */
+   void * mirrorbuf_create_shared(mirrorbuf_t * map, const char * name, size_t hsiz, size_t bsiz);
+   void * mirrorbuf_attach_shared(mirrorbuf_t * map, const char * name, size_t hsiz             );
+   int    mirrorbuf_unlink_shared(                   const char * name                          );
+
 #ifdef __cplusplus
 };
 #endif
@@ -0,0 +1,167 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "mirrorbuf.h"
+
+#ifndef __MSGRING_SPSC_H__
+#define __MSGRING_SPSC_H__
+
+///////////////////////////////////////////////////////////////////////////////
+/* single producer single consumer ring of variable length messages          */
+///////////////////////////////////////////////////////////////////////////////
+// Records are [uint32_t len | uint32_t pad | payload, padded to 8 bytes]
+// laid out back to back in a mirrorbuf, so a record that crosses the end
+// of the ring is still contiguous in memory: no split, no wrap branch.
+//
+//    producer : p = msgring_reserve(r, max); <write p>; msgring_commit(r, n);
+//    consumer : p = msgring_peek(r, &n);     <read  p>; msgring_release(r);
+//
+// head/tail are free running byte offsets, each on its own cache line
+// together with a cached copy of the other side's offset.
+///////////////////////////////////////////////////////////////////////////////
+#ifdef _WIN32
+#include <intrin.h>
+
+#define MSGRING_ALIGN_PRE           __declspec(align(64))
+#define MSGRING_ALIGN_POST
+
+#define MSGRING_LOAD_ACQ(ptr)       (_ReadWriteBarrier(), *(ptr))
+#define MSGRING_STORE_REL(ptr, val) do { _ReadWriteBarrier(); *(ptr) = (val); } while (0)
+#else
+#define MSGRING_ALIGN_PRE
+#define MSGRING_ALIGN_POST          __attribute__ ((aligned (64)))
+
+#define MSGRING_LOAD_ACQ(ptr)       __atomic_load_n ((ptr),        __ATOMIC_ACQUIRE)
+#define MSGRING_STORE_REL(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#endif
+
+#define MSGRING_HDRSIZE             8
+#define MSGRING_RECSIZE(len)        (MSGRING_HDRSIZE + (((uint64_t)(len) + 7) & ~7ULL))
+
+typedef struct msgring_t
+{
+   /* consumer line */
+   MSGRING_ALIGN_PRE volatile uint64_t head MSGRING_ALIGN_POST;
+   uint64_t tailcache;
+
+   /* producer line */
+   MSGRING_ALIGN_PRE volatile uint64_t tail MSGRING_ALIGN_POST;
+   uint64_t headcache;
+
+   MSGRING_ALIGN_PRE uint64_t size MSGRING_ALIGN_POST;
+   unsigned char * data;
+
+   mirrorbuf_t mbuf;
+} msgring_t;
+
+/* ring of (1 << order) bytes, order >= 12 (16 on windows) */
+static inline bool msgring_init(msgring_t * ring, int order)
+{
+   ring->size      = (1ULL << order);
+   ring->head      = 0;
+   ring->tail      = 0;
+   ring->headcache = 0;
+   ring->tailcache = 0;
+
+   ring->data = (unsigned char *)mirrorbuf_create(&(ring->mbuf), ring->size);
+   return (ring->data != NULL);
+}
+
+static inline void msgring_free(msgring_t * ring)
+{
+   mirrorbuf_destroy(&(ring->mbuf));
+   ring->data = NULL;
+}
+
+/* largest payload a single record can carry */
+static inline size_t msgring_maxlen(const msgring_t * ring)
+{
+   return (size_t)(ring->size - MSGRING_HDRSIZE);
+}
+
+static inline bool msgring_empty(const msgring_t * ring)
+{
+   return (MSGRING_LOAD_ACQ(&(ring->head)) == MSGRING_LOAD_ACQ(&(ring->tail)));
+}
+
+/* bytes in use, headers and padding included */
+static inline size_t msgring_size(const msgring_t * ring)
+{
+   uint64_t head = MSGRING_LOAD_ACQ(&(ring->head));
+   return (size_t)(MSGRING_LOAD_ACQ(&(ring->tail)) - head);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* producer side                                                             */
+///////////////////////////////////////////////////////////////////////////////
+/* room for (len) payload bytes, NULL if full; nothing is visible until commit */
+static inline void * msgring_reserve(msgring_t * ring, size_t len)
+{
+   uint64_t tail = ring->tail;
+   uint64_t need = MSGRING_RECSIZE(len);
+
+   if (need > ring->size) { return NULL; }
+
+   if (tail + need - ring->headcache > ring->size)
+   {
+      /* looks full, refresh the consumer's offset */
+      ring->headcache = MSGRING_LOAD_ACQ(&(ring->head));
+      if (tail + need - ring->headcache > ring->size) { return NULL; }
+   }
+
+   return (void *)(ring->data + (tail & (ring->size - 1)) + MSGRING_HDRSIZE);
+}
+
+/* publish the reserved record with its final (len), len <= reserved len */
+static inline void msgring_commit(msgring_t * ring, size_t len)
+{
+   uint64_t tail = ring->tail;
+
+   *(uint32_t *)(ring->data + (tail & (ring->size - 1))) = (uint32_t)len;
+   MSGRING_STORE_REL(&(ring->tail), tail + MSGRING_RECSIZE(len));
+}
+
+/* reserve + copy + commit */
+static inline bool msgring_push(msgring_t * ring, const void * pdata, size_t len)
+{
+   void * p = msgring_reserve(ring, len);
+   if (p == NULL) { return false; }
+
+   memcpy(p, pdata, len);
+   msgring_commit(ring, len);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/* consumer side                                                             */
+///////////////////////////////////////////////////////////////////////////////
+/* oldest record in place, NULL if empty; stays valid until release */
+static inline const void * msgring_peek(msgring_t * ring, size_t * plen)
+{
+   uint64_t head = ring->head;
+
+   if (head == ring->tailcache)
+   {
+      /* looks empty, refresh the producer's offset */
+      ring->tailcache = MSGRING_LOAD_ACQ(&(ring->tail));
+      if (head == ring->tailcache) { return NULL; }
+   }
+
+   const unsigned char * prec = ring->data + (head & (ring->size - 1));
+   *plen = *(const uint32_t *)prec;
+   return (const void *)(prec + MSGRING_HDRSIZE);
+}
+
+/* drop the record returned by the last peek */
+static inline void msgring_release(msgring_t * ring)
+{
+   uint64_t head = ring->head;
+   uint32_t len  = *(const uint32_t *)(ring->data + (head & (ring->size - 1)));
+
+   MSGRING_STORE_REL(&(ring->head), head + MSGRING_RECSIZE(len));
+}
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
\ No newline at end of file
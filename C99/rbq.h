@@ -15,11 +15,17 @@
 
 #define FAA(ptr)                    (_InterlockedIncrement64(ptr))
 #define FAS(ptr)                    (_InterlockedDecrement64(ptr))
+#define FAAN(ptr, n)                (_InterlockedExchangeAdd64((ptr), (n)))
+#define FAA32(ptr)                  (_InterlockedIncrement((volatile long *)(ptr)))
+#define FAS32(ptr)                  (_InterlockedDecrement((volatile long *)(ptr)))
 
 #define CACHE_ALIGN_PRE             __declspec(align(64))
 #define CACHE_ALIGN_POST
 
 #define Next2CurrIndex(index, size) (((index) - 1) & ((size) - 1))
+
+#define CPU_RELAX()                 _mm_pause()
+#define FULL_FENCE()                MemoryBarrier()
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <Windows.h>
@@ -52,66 +58,238 @@ static inline int sched_yield()
 
 #define FAA(ptr)                    __sync_fetch_and_add((ptr), 1)
 #define FAS(ptr)                    __sync_fetch_and_sub((ptr), 1)
+#define FAAN(ptr, n)                __sync_fetch_and_add((ptr), (n))
+#define FAA32(ptr)                  __sync_fetch_and_add((ptr), 1)
+#define FAS32(ptr)                  __sync_fetch_and_sub((ptr), 1)
 
 #define CACHE_ALIGN_PRE
 #define CACHE_ALIGN_POST            __attribute__ ((aligned (64)))
 
 #define Next2CurrIndex(index, size) (((index) - 0) & ((size) - 1))
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX()                 __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define CPU_RELAX()                 __asm__ __volatile__("yield")
+#else
+#define CPU_RELAX()
+#endif
+#define FULL_FENCE()                __sync_synchronize()
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <unistd.h>
 #include <sched.h>
 
-#define _aligned_malloc(n, a) aligned_alloc(a, n)
-#define _aligned_free(p)      free(p)
+#ifdef __linux__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 #endif // _WIN32
 
 #ifndef __LOCKFREE_RBQ_MPMC_H__
 #define __LOCKFREE_RBQ_MPMC_H__
 
+#include "lfmem.h"
+#include "mirrorbuf.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/* wait policies, RBQ_PROTOTYPE(name, type, copyfunc, waitfunc) takes one of */
+/* rbq_sleep/rbq_spin/rbq_yield/rbq_park (or a user family) as waitfunc.     */
+/*                                                                           */
+/* waitfunc##_wait(waiters, pstatus, seen, spins) is called while the slot   */
+/* status is (seen), waitfunc##_wake(waiters, pstatus) is called right after */
+/* the completing side updated the status of the slot.                       */
+///////////////////////////////////////////////////////////////////////////////
+#ifndef RBQ_SPIN_LIMIT
+#define RBQ_SPIN_LIMIT (64)
+#endif
+
+/* timer sleep of 1~2us (~50us on linux), cheapest on CPU */
+static inline void rbq_sleep_wait(
+    volatile uint32_t* waiters, volatile uint32_t* pstatus, uint32_t seen, uint32_t spins
+)
+{
+    usleep((spins & 1) + 1);
+}
+
+static inline void rbq_sleep_wake(volatile uint32_t* waiters, volatile uint32_t* pstatus)
+{
+}
+
+/* busy spin with pause, lowest latency, burns a core */
+static inline void rbq_spin_wait(
+    volatile uint32_t* waiters, volatile uint32_t* pstatus, uint32_t seen, uint32_t spins
+)
+{
+    CPU_RELAX();
+}
+
+static inline void rbq_spin_wake(volatile uint32_t* waiters, volatile uint32_t* pstatus)
+{
+}
+
+/* spin RBQ_SPIN_LIMIT rounds, then give up the time slice */
+static inline void rbq_yield_wait(
+    volatile uint32_t* waiters, volatile uint32_t* pstatus, uint32_t seen, uint32_t spins
+)
+{
+    if (spins < RBQ_SPIN_LIMIT) { CPU_RELAX(); } else { sched_yield(); }
+}
+
+static inline void rbq_yield_wake(volatile uint32_t* waiters, volatile uint32_t* pstatus)
+{
+}
+
+/* spin RBQ_SPIN_LIMIT rounds, then park on the slot status (futex), */
+/* the completing side only wakes the slot if anyone is parked.      */
+static inline void rbq_park_wait(
+    volatile uint32_t* waiters, volatile uint32_t* pstatus, uint32_t seen, uint32_t spins
+)
+{
+    if (spins < RBQ_SPIN_LIMIT) { CPU_RELAX(); return; }
+
+    FAA32(waiters);
+#ifdef __linux__
+    syscall(SYS_futex, pstatus, FUTEX_WAIT, seen, NULL, NULL, 0);
+#else
+    sched_yield();
+#endif
+    FAS32(waiters);
+}
+
+static inline void rbq_park_wake(volatile uint32_t* waiters, volatile uint32_t* pstatus)
+{
+    /* pairs with FAA32 in rbq_park_wait(): either we see the sleeper, */
+    /* or the sleeper sees the new status in FUTEX_WAIT.               */
+    FULL_FENCE();
+    if (*waiters == 0) { return; }
+#ifdef __linux__
+    syscall(SYS_futex, pstatus, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////
+
 #define RBQ_NODE(name, type)                                            \
     typedef struct CACHE_ALIGN_PRE name##_rbqnode_t {                   \
         type object;                                                    \
         volatile uint32_t status;                                       \
     } CACHE_ALIGN_POST name##_rbqnode_t;
 
+#define RBQ_NODE_DENSE(name, type)                                      \
+    /* packed nodes, see RBQ_PROTOTYPE_DENSE */                         \
+    typedef struct name##_rbqnode_t {                                   \
+        type object;                                                    \
+        volatile uint32_t status;                                       \
+    } name##_rbqnode_t;
+
 #define RBQ_HEAD(name, type)                                            \
     typedef struct name##_t {                                           \
         CACHE_ALIGN_PRE volatile uint64_t head CACHE_ALIGN_POST;        \
         CACHE_ALIGN_PRE volatile uint64_t tail CACHE_ALIGN_POST;        \
         CACHE_ALIGN_PRE size_t size CACHE_ALIGN_POST;                   \
-        name##_rbqnode_t * data;                                        \
+        uint32_t order; /* log2(size) */                                \
+        intptr_t offs;  /* nodes, relative to this header */            \
+        uint64_t magic; /* set once a shared header is ready */         \
+        int      mflg;  /* LFMEM_* flags of the nodes */                \
+        CACHE_ALIGN_PRE volatile uint32_t waiters CACHE_ALIGN_POST;     \
     } name##_t;
 
+#define RBQ_DATA(name)                                                  \
+    /* the node array is addressed relative to the header, so that */   \
+    /* the header and nodes can live in a shared mapping placed at */   \
+    /* a different address in every process.                       */   \
+    static inline name##_rbqnode_t* name##_data(const name##_t* rbq)    \
+    {                                                                   \
+        return (name##_rbqnode_t*)((intptr_t)rbq + rbq->offs);          \
+    };
+
+#define RBQ_SLOT(name)                                                  \
+    /* node of ticket (index): one node per cache line already */       \
+    static inline size_t name##_slot(                                   \
+        const name##_t* rbq, uint64_t index                             \
+    )                                                                   \
+    {                                                                   \
+        return (size_t)(index & (rbq->size - 1));                       \
+    };
+
+#define RBQ_SLOT_DENSE(name)                                            \
+    /* nodes per cache line, rounded up to a power of 2 (1 << shift) */ \
+    static inline uint32_t name##_lineshift(void)                       \
+    {                                                                   \
+        uint32_t shift = 0;                                             \
+        while ((sizeof(name##_rbqnode_t) << shift) < 64) { ++shift; }   \
+        return shift;                                                   \
+    };                                                                  \
+                                                                        \
+    /* node of ticket (index): with R = size >> shift rows, ticket */   \
+    /* i goes to row (i % R), column (i / R) of the node matrix so */   \
+    /* that neighbouring tickets sit on different cache lines.     */   \
+    static inline size_t name##_slot(                                   \
+        const name##_t* rbq, uint64_t index                             \
+    )                                                                   \
+    {                                                                   \
+        uint32_t shift = name##_lineshift();                            \
+        size_t   i     = (size_t)(index & (rbq->size - 1));             \
+        if (rbq->order <= shift) { return i; }                          \
+        size_t   rows  = rbq->size >> shift;                            \
+        return ((i & (rows - 1)) << shift) | (i >> (rbq->order-shift)); \
+    };
+
 #define STATUS_EMPT    (0)
 #define STATUS_FILL    (1)
 #define STATUS_READ    (2)
 #define STATUS_FULL    (3)
 
 #define RBQ_INIT(name)                                                  \
-    static inline bool name##_init(                                     \
-        name##_t* rbq, int order                                        \
+    static inline bool name##_init_ex(                                  \
+        name##_t* rbq, int order, int flags                             \
     )                                                                   \
     {                                                                   \
         rbq->size = (1ULL << order);                                    \
+        rbq->order = order;                                             \
         rbq->head = 0;                                                  \
         rbq->tail = 0;                                                  \
+        rbq->waiters = 0;                                               \
+        rbq->magic = 0;                                                 \
+        rbq->mflg = flags;                                              \
                                                                         \
-        rbq->data = (name##_rbqnode_t*)_aligned_malloc(                 \
-            rbq->size * sizeof(name##_rbqnode_t), 16                    \
+        name##_rbqnode_t* data = (name##_rbqnode_t*)lfmem_alloc(        \
+            rbq->size * sizeof(name##_rbqnode_t), flags                 \
         );                                                              \
+        if (data == NULL) { return false; }                             \
+                                                                        \
         memset(                                                         \
-            (void*)rbq->data, 0, rbq->size * sizeof(name##_rbqnode_t)   \
+            (void*)data, 0, rbq->size * sizeof(name##_rbqnode_t)        \
         );                                                              \
+        rbq->offs = (intptr_t)data - (intptr_t)rbq;                     \
         /* printf("%d\n", sizeof(name##_rbqnode_t));                 */ \
-        return (rbq->data != NULL);                                     \
+        return true;                                                    \
+    };                                                                  \
+                                                                        \
+    static inline bool name##_init(                                     \
+        name##_t* rbq, int order                                        \
+    )                                                                   \
+    {                                                                   \
+        return name##_init_ex(rbq, order, 0);                           \
     };
 
 #define RBQ_FREE(name)                                                  \
     static inline void name##_free(name##_t* rbq)                       \
     {                                                                   \
-        _aligned_free(rbq->data);                                       \
+        size_t nsiz = rbq->size * sizeof(name##_rbqnode_t);             \
+        lfmem_free(name##_data(rbq), nsiz, rbq->mflg);                  \
+    };
+
+#define RBQ_BIND(name)                                                  \
+    /* move the nodes to NUMA (node), e.g. lfmem_current_node() of  */  \
+    /* the consumer; only for nodes mapped by rbq_init_ex(flags!=0) */  \
+    static inline bool name##_bind(name##_t* rbq, int node)             \
+    {                                                                   \
+        size_t nsiz = rbq->size * sizeof(name##_rbqnode_t);             \
+        if (rbq->mflg == 0) { return false; }                           \
+        return lfmem_bind(name##_data(rbq), nsiz, node);                \
     };
 
 #define RBQ_FULL(name)                                                  \
@@ -155,10 +333,17 @@ static inline int sched_yield()
         /* We know that space @ currWriteIndex is reserved for us. */   \
         /* In case of slow writer,                                 */   \
         /* we use CAS to ensure a correct data swap.               */   \
-        name##_rbqnode_t* pnode = rbq->data + currWriteIndex;           \
+        name##_rbqnode_t* pnode =                                       \
+            name##_data(rbq) + name##_slot(rbq, currWriteIndex);        \
+        uint32_t spins = 0;                                             \
         while (!CAS32(&(pnode->status), STATUS_EMPT, STATUS_FILL))      \
         {                                                               \
-            waitfunc((currWriteIndex & 1) + 1);                         \
+            uint32_t seen = pnode->status;                              \
+            if (seen != STATUS_EMPT) {                                  \
+                waitfunc##_wait(                                        \
+                    &(rbq->waiters), &(pnode->status), seen, spins++    \
+                );                                                      \
+            }                                                           \
         }                                                               \
                                                                         \
         /* fill - exclusive */                                          \
@@ -166,6 +351,7 @@ static inline int sched_yield()
                                                                         \
         /* done - update status */                                      \
         pnode->status = STATUS_FULL;                                    \
+        waitfunc##_wake(&(rbq->waiters), &(pnode->status));             \
                                                                         \
         return true;                                                    \
     };
@@ -191,10 +377,17 @@ static inline int sched_yield()
         /* We know that space @ currReadIndex is reserved for us.    */ \
         /* In case of slow writer,                                   */ \
         /* we use CAS to ensure a correct data swap                  */ \
-        name##_rbqnode_t* pnode = rbq->data + currReadIndex;            \
+        name##_rbqnode_t* pnode =                                       \
+            name##_data(rbq) + name##_slot(rbq, currReadIndex);         \
+        uint32_t spins = 0;                                             \
         while (!CAS32(&(pnode->status), STATUS_FULL, STATUS_READ))      \
         {                                                               \
-            waitfunc((currReadIndex & 1) + 1);                          \
+            uint32_t seen = pnode->status;                              \
+            if (seen != STATUS_FULL) {                                  \
+                waitfunc##_wait(                                        \
+                    &(rbq->waiters), &(pnode->status), seen, spins++    \
+                );                                                      \
+            }                                                           \
         }                                                               \
                                                                         \
         /* read - exclusive */                                          \
@@ -202,11 +395,104 @@ static inline int sched_yield()
                                                                         \
         /* done - update status */                                      \
         pnode->status = STATUS_EMPT;                                    \
+        waitfunc##_wake(&(rbq->waiters), &(pnode->status));             \
                                                                         \
         /* return - data */                                             \
         return true;                                                    \
     };
 
+#define RBQ_PUSHN(name, type, copyfunc, waitfunc)                       \
+    /* push @ mutiple producers, reserve n slots with one FAA */        \
+    static inline size_t name##_push_n(                                 \
+        name##_t* rbq, const type * pdata, size_t n                     \
+    )                                                                   \
+    {                                                                   \
+        uint64_t currReadIndexA, currWriteIndex, nextWriteIndex;        \
+                                                                        \
+        /* check rbq queue full, clamp n to the free space */           \
+        currWriteIndex = rbq->tail;                                     \
+        currReadIndexA = rbq->head;                                     \
+        if (currWriteIndex >= (currReadIndexA + rbq->size)){            \
+            return 0;                                                   \
+        }                                                               \
+        if (n > (currReadIndexA + rbq->size - currWriteIndex)){         \
+            n = (currReadIndexA + rbq->size - currWriteIndex);          \
+        }                                                               \
+        if (n == 0){return 0;}                                          \
+                                                                        \
+        /* reserve [nextWriteIndex, nextWriteIndex + n) */              \
+        nextWriteIndex = FAAN(&(rbq->tail), n);                         \
+        for (size_t i = 0; i < n; ++i)                                  \
+        {                                                               \
+            currWriteIndex = name##_slot(rbq, nextWriteIndex + i);      \
+            name##_rbqnode_t* pnode = name##_data(rbq) + currWriteIndex;\
+            uint32_t spins = 0;                                         \
+            while (!CAS32(&(pnode->status), STATUS_EMPT, STATUS_FILL))  \
+            {                                                           \
+                uint32_t seen = pnode->status;                          \
+                if (seen != STATUS_EMPT) {                              \
+                    waitfunc##_wait(                                    \
+                        &(rbq->waiters), &(pnode->status), seen, spins++\
+                    );                                                  \
+                }                                                       \
+            }                                                           \
+                                                                        \
+            /* fill - exclusive */                                      \
+            copyfunc(pdata + i, &(pnode->object));                      \
+                                                                        \
+            /* done - update status */                                  \
+            pnode->status = STATUS_FULL;                                \
+            waitfunc##_wake(&(rbq->waiters), &(pnode->status));         \
+        }                                                               \
+                                                                        \
+        return n;                                                       \
+    };
+
+#define RBQ_POPN(name, type, copyfunc, waitfunc)                        \
+    /* pop @ mutiple consumers, reserve n slots with one FAA */         \
+    static inline size_t name##_pop_n(                                  \
+        name##_t* rbq, type * pdata, size_t n                           \
+    )                                                                   \
+    {                                                                   \
+        uint64_t currWritIndex, currReadIndex, nextReadIndex;           \
+                                                                        \
+        /* check queue empty, clamp n to the objects in queue */        \
+        currReadIndex = rbq->head;                                      \
+        currWritIndex = rbq->tail;                                      \
+        if (currReadIndex >= currWritIndex){return 0;}                  \
+        if (n > (currWritIndex - currReadIndex)){                       \
+            n = (currWritIndex - currReadIndex);                        \
+        }                                                               \
+        if (n == 0){return 0;}                                          \
+                                                                        \
+        /* reserve [nextReadIndex, nextReadIndex + n) */                \
+        nextReadIndex = FAAN(&(rbq->head), n);                          \
+        for (size_t i = 0; i < n; ++i)                                  \
+        {                                                               \
+            currReadIndex = name##_slot(rbq, nextReadIndex + i);        \
+            name##_rbqnode_t* pnode = name##_data(rbq) + currReadIndex; \
+            uint32_t spins = 0;                                         \
+            while (!CAS32(&(pnode->status), STATUS_FULL, STATUS_READ))  \
+            {                                                           \
+                uint32_t seen = pnode->status;                          \
+                if (seen != STATUS_FULL) {                              \
+                    waitfunc##_wait(                                    \
+                        &(rbq->waiters), &(pnode->status), seen, spins++\
+                    );                                                  \
+                }                                                       \
+            }                                                           \
+                                                                        \
+            /* read - exclusive */                                      \
+            copyfunc(&(pnode->object), pdata + i);                      \
+                                                                        \
+            /* done - update status */                                  \
+            pnode->status = STATUS_EMPT;                                \
+            waitfunc##_wake(&(rbq->waiters), &(pnode->status));         \
+        }                                                               \
+                                                                        \
+        return n;                                                       \
+    };
+
 #define RBQ_PUSHSP(name, type, copyfunc)                                \
     /* push @ single producer single consumer */                        \
     static inline bool name##_pushspsc(                                 \
@@ -220,8 +506,8 @@ static inline int sched_yield()
             return false;                                               \
         }                                                               \
                                                                         \
-        currWriteIndex = currWriteIndex & (rbq->size - 1);              \
-        name##_rbqnode_t* pnode = rbq->data + currWriteIndex;           \
+        name##_rbqnode_t* pnode =                                       \
+            name##_data(rbq) + name##_slot(rbq, currWriteIndex);        \
                                                                         \
         copyfunc(pdata, &(pnode->object));                              \
                                                                         \
@@ -240,20 +526,98 @@ static inline int sched_yield()
         uint64_t currWritIndex = rbq->tail;                             \
         if (currReadIndex >= currWritIndex){return false;}              \
                                                                         \
-        currReadIndex = currReadIndex & (rbq->size - 1);                \
-        name##_rbqnode_t* pnode = rbq->data + currReadIndex;            \
+        name##_rbqnode_t* pnode =                                       \
+            name##_data(rbq) + name##_slot(rbq, currReadIndex);         \
         copyfunc(&(pnode->object), pdata);                              \
                                                                         \
         rbq->head = currReadIndex + 1;                                  \
         return true;                                                    \
     };
 
+#define RBQ_SHM_MAGIC  (0x31304d4853514252ULL) /* "RBQSHM01" */
+
+#define RBQ_SHM(name)                                                   \
+    /* per process handle of a named shared rbq, the header and  */     \
+    /* the nodes live in the mapping: [name##_t][nodes]          */     \
+    typedef struct name##_shm_t {                                       \
+        name##_t*   rbq;                                                \
+        mirrorbuf_t mbuf;                                               \
+    } name##_shm_t;                                                     \
+                                                                        \
+    static inline name##_t* name##_shm_create(                          \
+        name##_shm_t* shm, const char* path, int order                  \
+    )                                                                   \
+    {                                                                   \
+        size_t size = (1ULL << order);                                  \
+        shm->rbq = (name##_t*)mirrorbuf_create_shared(                  \
+            &(shm->mbuf), path,                                         \
+            sizeof(name##_t), size * sizeof(name##_rbqnode_t)           \
+        );                                                              \
+        if (shm->rbq == NULL) { return NULL; }                          \
+                                                                        \
+        /* fresh pages are zero: head, tail, all slots STATUS_EMPT */   \
+        shm->rbq->size = size;                                          \
+        shm->rbq->order = order;                                        \
+        shm->rbq->offs = (intptr_t)shm->mbuf.hsiz;                      \
+                                                                        \
+        /* publish the header last */                                   \
+        FULL_FENCE();                                                   \
+        shm->rbq->magic = RBQ_SHM_MAGIC;                                \
+        return shm->rbq;                                                \
+    };                                                                  \
+                                                                        \
+    static inline name##_t* name##_shm_attach(                          \
+        name##_shm_t* shm, const char* path                             \
+    )                                                                   \
+    {                                                                   \
+        shm->rbq = (name##_t*)mirrorbuf_attach_shared(                  \
+            &(shm->mbuf), path, sizeof(name##_t)                        \
+        );                                                              \
+        if (shm->rbq == NULL) { return NULL; }                          \
+                                                                        \
+        /* not ready yet, or built for another node type */             \
+        size_t nsiz = shm->rbq->size * sizeof(name##_rbqnode_t);        \
+        if ((shm->rbq->magic != RBQ_SHM_MAGIC) ||                       \
+            (nsiz != shm->mbuf.bsiz))                                   \
+        {                                                               \
+            mirrorbuf_destroy(&(shm->mbuf));                            \
+            return (shm->rbq = NULL);                                   \
+        }                                                               \
+        FULL_FENCE();                                                   \
+        return shm->rbq;                                                \
+    };                                                                  \
+                                                                        \
+    static inline void name##_shm_detach(name##_shm_t* shm)             \
+    {                                                                   \
+        mirrorbuf_destroy(&(shm->mbuf));                                \
+        shm->rbq = NULL;                                                \
+    };                                                                  \
+                                                                        \
+    static inline int name##_shm_unlink(const char* path)               \
+    {                                                                   \
+        return mirrorbuf_unlink_shared(path);                           \
+    };
+
 #define RBQ_PROTOTYPE(name, type, copyfunc, waitfunc)                   \
     RBQ_NODE(name, type);                                               \
     RBQ_HEAD(name, type);                                               \
-                                                                        \
+    RBQ_DATA(name);                                                     \
+    RBQ_SLOT(name);                                                     \
+    RBQ_BODY(name, type, copyfunc, waitfunc);
+
+/* same API, nodes packed: ~sizeof(type) + 4 bytes per slot instead of */
+/* 64, neighbouring tickets still land on different cache lines.       */
+#define RBQ_PROTOTYPE_DENSE(name, type, copyfunc, waitfunc)             \
+    RBQ_NODE_DENSE(name, type);                                         \
+    RBQ_HEAD(name, type);                                               \
+    RBQ_DATA(name);                                                     \
+    RBQ_SLOT_DENSE(name);                                               \
+    RBQ_BODY(name, type, copyfunc, waitfunc);
+
+#define RBQ_BODY(name, type, copyfunc, waitfunc)                        \
     RBQ_INIT(name);                                                     \
     RBQ_FREE(name);                                                     \
+    RBQ_BIND(name);                                                     \
                                                                         \
     RBQ_FULL(name);                                                     \
     RBQ_EMPT(name);                                                     \
@@ -262,7 +626,14 @@ static inline int sched_yield()
     RBQ_PUSH(name, type, copyfunc, waitfunc);                           \
     RBQ_POP (name, type, copyfunc, waitfunc);                           \
                                                                         \
+    RBQ_PUSHN(name, type, copyfunc, waitfunc);                          \
+    RBQ_POPN (name, type, copyfunc, waitfunc);                          \
+                                                                        \
     RBQ_PUSHSP(name, type, copyfunc);                                   \
     RBQ_POPSC (name, type, copyfunc);
 
+/* named shared memory rbq, use next to RBQ_PROTOTYPE(name, ...) */
+#define RBQ_SHM_PROTOTYPE(name)                                         \
+    RBQ_SHM(name);
+
 #endif
\ No newline at end of file
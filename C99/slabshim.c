@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+/* LD_PRELOAD malloc shim over slab_* (fixedSizeMemoryLF.c)                  */
+///////////////////////////////////////////////////////////////////////////////
+//   make libslab.so
+//   LD_PRELOAD=./libslab.so <service>
+//
+// Every allocation entry point of the C library is replaced, so that no
+// block of one allocator is ever handed to the other one. The size class
+// lists start empty and need no startup call; nothing is given back to the
+// system until exit (mmFixedSizeMemoryCleanup is never called here).
+///////////////////////////////////////////////////////////////////////////////
+#ifndef _WIN32
+
+#include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "fixedSizeMemoryLF.h"
+
+#define SLABSHIM_EXPORT __attribute__ ((visibility ("default")))
+
+SLABSHIM_EXPORT void * malloc(size_t size)
+{
+   return slab_malloc(size);
+}
+
+SLABSHIM_EXPORT void free(void * pmem)
+{
+   slab_free(pmem);
+}
+
+SLABSHIM_EXPORT void cfree(void * pmem)
+{
+   slab_free(pmem);
+}
+
+SLABSHIM_EXPORT void * calloc(size_t numblk, size_t blksize)
+{
+   return slab_calloc(blksize, numblk);
+}
+
+SLABSHIM_EXPORT void * realloc(void * pmem, size_t size)
+{
+   return slab_realloc(pmem, size);
+}
+
+SLABSHIM_EXPORT void * reallocarray(void * pmem, size_t numblk, size_t blksize)
+{
+   if ((numblk != 0) && (blksize > (size_t)-1 / numblk)) { errno = ENOMEM; return NULL; }
+   return slab_realloc(pmem, numblk * blksize);
+}
+
+SLABSHIM_EXPORT void * memalign(size_t align, size_t size)
+{
+   return slab_memalign(align, size);
+}
+
+SLABSHIM_EXPORT void * aligned_alloc(size_t align, size_t size)
+{
+   return slab_memalign(align, size);
+}
+
+SLABSHIM_EXPORT int posix_memalign(void ** pmem, size_t align, size_t size)
+{
+   if ((align < sizeof(void *)) || ((align & (align - 1)) != 0)) { return EINVAL; }
+
+   void * p = slab_memalign(align, size);
+   if (p == NULL) { return ENOMEM; }
+
+   *pmem = p;
+   return 0;
+}
+
+SLABSHIM_EXPORT void * valloc(size_t size)
+{
+   return slab_memalign((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+SLABSHIM_EXPORT void * pvalloc(size_t size)
+{
+   size_t page = (size_t)sysconf(_SC_PAGESIZE);
+   return slab_memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+SLABSHIM_EXPORT size_t malloc_usable_size(void * pmem)
+{
+   return (pmem != NULL) ? slab_usable(pmem) : 0;
+}
+
+#endif // _WIN32
\ No newline at end of file